@@ -0,0 +1,203 @@
+// Transmit arbiter, which channel's frame goes to the radio next
+
+#include <string.h>
+#include "arbiter.h"
+#include "framer.h"
+#include "timebase.h"
+
+static arb_policy_t policy;
+static int last;                        // channel picked last, the turn goes on from there
+static arbiter_stats_t waits[Nchannels];
+
+// Oldest first: frames the round robin took before their order entry came up, and those it
+// took of the frames that have none (frameq_unordered)
+static uint32_t ahead[Nchannels];
+static uint32_t unordered[Nchannels];
+
+// Punch time merge: the next frame of each channel, read from its frame queue
+static struct {
+    frame_t frame;
+    ring_span_t data[2];
+    uint32_t time;                      // punch time, see framer_punch_time()
+    bool punch;                         // else not a punch, goes first
+} held[Nchannels];
+static bool holding[Nchannels];
+static int heap[Nchannels];             // channels holding a frame, a min heap by punch time
+static int heapSize;
+
+void arbiter_init(arb_policy_t p) {
+    policy = p;
+    last = Nchannels - 1;
+    memset(waits, 0, sizeof(waits));
+    memset(holding, 0, sizeof(holding));
+    heapSize = 0;
+    memset(ahead, 0, sizeof(ahead));
+    for (int chan=0; chan<Nchannels; chan++) {
+        unordered[chan] = frameq_unordered(chan);
+    }
+    frameq_order(p == ARB_OLDEST_FIRST);
+}
+
+// The first channel with a frame, in turn after the last one picked
+static bool roundRobin(frame_t *frame, ring_span_t data[2]) {
+    for (int i=1; i<=Nchannels; i++) {
+        if (frameq_read((last + i) % Nchannels, frame, data)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool oldestFirst(frame_t *frame, ring_span_t data[2]) {
+    int chan;
+    while ((chan = frameq_oldest()) >= 0) {
+        if (ahead[chan] > 0) {                  // Its frame went already
+            ahead[chan]--;
+        } else if (frameq_in_flight(chan) == FRAMEQ_IN_FLIGHT) {
+            return false;                       // The oldest waits until one is released
+        } else if (frameq_read(chan, frame, data)) {
+            frameq_oldest_taken();
+            return true;
+        }
+        frameq_oldest_taken();                  // Entries of frames lost since are dropped here
+    }
+    // A frame published an instant ago, its entry still to come, or one whose entry did not fit
+    if (!roundRobin(frame, data)) {
+        return false;
+    }
+    chan = frame->chan;
+    if (unordered[chan] != frameq_unordered(chan)) {
+        unordered[chan]++;
+    } else {
+        ahead[chan]++;
+    }
+    return true;
+}
+
+static bool longestQueue(frame_t *frame, ring_span_t data[2]) {
+    int longest = -1;
+    size_t most = 0;
+    for (int i=1; i<=Nchannels; i++) {          // Ties go in turn
+        int chan = (last + i) % Nchannels;
+        size_t count = frameq_count(chan);
+        if (count > most) {
+            most = count;
+            longest = chan;
+        }
+    }
+    if (longest >= 0 && frameq_read(longest, frame, data)) {
+        return true;
+    }
+    return roundRobin(frame, data);             // Only lost bytes queued there
+}
+
+// Frame of channel a before that of channel b
+static bool before(int a, int b) {
+    if (held[a].punch != held[b].punch) {
+        return !held[a].punch;
+    }
+    int32_t d = held[a].punch ? framer_punch_time_diff(held[a].time, held[b].time) : 0;
+    return d ? d < 0 : (int32_t)(held[a].frame.arrival - held[b].frame.arrival) < 0;
+}
+
+static void swap(int i, int j) {
+    int t = heap[i];
+    heap[i] = heap[j];
+    heap[j] = t;
+}
+
+static void heapPush(int chan) {
+    int i = heapSize++;
+    heap[i] = chan;
+    while (i > 0 && before(heap[i], heap[(i - 1) / 2])) {
+        swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static int heapPop(void) {
+    int top = heap[0];
+    heap[0] = heap[--heapSize];
+    for (int i=0; ; ) {
+        int first = i, left = 2 * i + 1, right = left + 1;
+        if (left < heapSize && before(heap[left], heap[first])) {
+            first = left;
+        }
+        if (right < heapSize && before(heap[right], heap[first])) {
+            first = right;
+        }
+        if (first == i) {
+            break;
+        }
+        swap(i, first);
+        i = first;
+    }
+    return top;
+}
+
+// Until the earliest frame held may go: 0 when every channel holds one or it is not a punch
+static uint32_t dueUs(void) {
+    const int top = heap[0];
+    if (heapSize == Nchannels || !held[top].punch) {
+        return 0;
+    }
+    uint32_t age = timebase_us() - held[top].frame.arrival;
+    return age >= MERGE_WINDOW_MS * 1000u ? 0 : MERGE_WINDOW_MS * 1000u - age;
+}
+
+static bool punchTime(frame_t *frame, ring_span_t data[2]) {
+    for (int chan=0; chan<Nchannels; chan++) {          // Refill
+        if (!holding[chan] && frameq_read(chan, &held[chan].frame, held[chan].data)) {
+            held[chan].punch = framer_punch_time(held[chan].data, held[chan].frame.len, &held[chan].time);
+            holding[chan] = true;
+            heapPush(chan);
+        }
+    }
+    if (heapSize == 0 || dueUs() > 0) {
+        return false;
+    }
+    int chan = heapPop();
+    holding[chan] = false;
+    *frame = held[chan].frame;
+    data[0] = held[chan].data[0];
+    data[1] = held[chan].data[1];
+    return true;
+}
+
+uint32_t arbiter_due_us(void) {
+    return policy == ARB_PUNCH_TIME && heapSize > 0 ? dueUs() : UINT32_MAX;
+}
+
+bool arbiter_next(frame_t *frame, ring_span_t data[2]) {
+    bool found;
+    switch (policy) {
+    case ARB_OLDEST_FIRST:
+        found = oldestFirst(frame, data);
+        break;
+    case ARB_LONGEST_QUEUE:
+        found = longestQueue(frame, data);
+        break;
+    case ARB_PUNCH_TIME:
+        found = punchTime(frame, data);
+        break;
+    default:
+        found = roundRobin(frame, data);
+        break;
+    }
+    if (!found) {
+        return false;
+    }
+    last = frame->chan;
+    arbiter_stats_t *w = &waits[frame->chan];
+    uint32_t wait = timebase_us() - frame->arrival;
+    w->frames++;
+    w->sumWaitUs += wait;
+    if (wait > w->maxWaitUs) {
+        w->maxWaitUs = wait;
+    }
+    return true;
+}
+
+void arbiter_stats(int chan, arbiter_stats_t *stats) {
+    *stats = waits[chan];
+}
@@ -0,0 +1,50 @@
+#ifndef ARBITER_H
+#define ARBITER_H
+
+// Transmit arbiter: picks the next frame for the single radio output among the channels
+// with frames ready (frameq.h), by a policy chosen at start up:
+//  - round robin: the channels take turns, a busy channel cannot hold the link;
+//  - oldest first: frames go in the order they were completed, whichever channel;
+//  - longest queue first: the channel with most frames waiting, the one closest to overflowing;
+//  - punch time: punches in the order they were punched, by the time in the punch (framer.h).
+//    A k-way merge: the arbiter holds each channel's next frame in a heap by punch time and
+//    lets the earliest go once every channel has one held, so nothing earlier can come, or
+//    when it has been held MERGE_WINDOW_MS. Frames that are not punches go at once.
+// A decision never looks at more than the Nchannels queue counts, however many frames wait;
+// oldest first takes the order recorded by the frame queue instead of comparing arrival times,
+// and when the oldest frame's channel has FRAMEQ_IN_FLIGHT frames out, waits for it.
+// Per channel statistics of the wait from frame arrival until the arbiter picked it.
+// Runs on the transmitting core only.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "frameq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ARB_ROUND_ROBIN,
+    ARB_OLDEST_FIRST,
+    ARB_LONGEST_QUEUE,
+    ARB_PUNCH_TIME,
+} arb_policy_t;
+
+typedef struct {
+    uint32_t frames;            // frames picked
+    uint32_t maxWaitUs;         // longest from frame arrival until picked
+    uint64_t sumWaitUs;         // for the mean over frames
+} arbiter_stats_t;
+
+void arbiter_init(arb_policy_t policy);         // before the framer starts
+bool arbiter_next(frame_t *frame, ring_span_t data[2]); // frameq_read of the channel picked
+uint32_t arbiter_due_us(void);                  // until a frame held is due, UINT32_MAX if none
+void arbiter_stats(int chan, arbiter_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+// Input baud rate of each channel, fixed or detected
+
+#include "autobaud.h"
+
+static const uint32_t rates[] = AUTOBAUD_RATES;
+#define Nrates (int)(sizeof(rates) / sizeof(rates[0]))
+
+static struct {
+    uint32_t baud;
+    bool locked;
+    int tried;                  // index into rates[]
+    uint32_t bytes;             // counters when the rate was set
+    uint32_t errors;
+    uint32_t punches;
+    bool sampled;               // counters taken at this rate
+} line[Nchannels];
+
+void autobaud_init(int chan, uint32_t baud) {
+    line[chan].baud = baud == AUTOBAUD ? rates[0] : baud;
+    line[chan].locked = baud != AUTOBAUD;
+    line[chan].tried = 0;
+    line[chan].sampled = false;
+}
+
+uint32_t autobaud_rate(int chan) {
+    return line[chan].baud;
+}
+
+bool autobaud_locked(int chan) {
+    return line[chan].locked;
+}
+
+uint32_t autobaud_poll(int chan, uint32_t bytes, uint32_t errors, uint32_t punches) {
+    if (line[chan].locked) {
+        return 0;
+    }
+    if (!line[chan].sampled) {              // First look at this rate
+        line[chan].bytes = bytes;
+        line[chan].errors = errors;
+        line[chan].punches = punches;
+        line[chan].sampled = true;
+        return 0;
+    }
+    if (punches != line[chan].punches) {    // Punches come through: this is it
+        line[chan].locked = true;
+        return 0;
+    }
+    if (errors - line[chan].errors < AUTOBAUD_ERRORS && bytes - line[chan].bytes < AUTOBAUD_BYTES) {
+        return 0;
+    }
+    line[chan].tried = (line[chan].tried + 1) % Nrates;
+    line[chan].baud = rates[line[chan].tried];
+    line[chan].sampled = false;
+    return line[chan].baud;
+}
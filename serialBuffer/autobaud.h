@@ -0,0 +1,34 @@
+#ifndef AUTOBAUD_H
+#define AUTOBAUD_H
+
+// Input baud rate of each channel: fixed, or detected from the first bytes received.
+// A detecting channel tries the AUTOBAUD_RATES in turn. It moves on to the next rate after
+// AUTOBAUD_ERRORS framing errors or breaks, or AUTOBAUD_BYTES bytes without a punch header,
+// and keeps the rate at which the framer validated a punch (framer_stats). The bytes
+// received before are relayed as they came, like any other.
+// Hardware independent: the caller samples the reception counters and sets the rate it is
+// told (main.c, on core1).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUTOBAUD 0              // channel[].baud: detect
+
+void autobaud_init(int chan, uint32_t baud);    // a rate, or AUTOBAUD
+uint32_t autobaud_rate(int chan);               // the rate the channel is set to
+bool autobaud_locked(int chan);                 // fixed, or detected
+
+// The channel's counters since start up: bytes received, framing errors and breaks, punches
+// validated. Returns a rate to set the receiver to now, 0 to keep it.
+uint32_t autobaud_poll(int chan, uint32_t bytes, uint32_t errors, uint32_t punches);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
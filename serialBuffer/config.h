@@ -0,0 +1,87 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Build time configuration shared by main.c and the queue instances (ring.cpp)
+
+// SRR inputs: UART0 and UART1, then PIO UART receivers (main.c), at most 2 + 8
+#ifndef Nchannels
+#define Nchannels 2
+#endif
+
+// Queue capacities; must be powers of two (checked by RingBuffer)
+// Queue for received punches as stream bytes, kept there until sent (at most 64K).
+// Smaller with more than four channels, to fit the RP2040's 264K RAM.
+#define RX_QUEUE_SIZE (Nchannels <= 4 ? 32*1024 : 16*1024)
+#define FRAME_QUEUE_SIZE 256    // Queue for tx-ready punches as descriptors into the rx queue (8 bytes each)
+
+// Line rates. Each input's rate is in its channel[] row in main.c, 38400 or legacy 4800 for
+// an SRR, or AUTOBAUD to detect it among AUTOBAUD_RATES (autobaud.h). The radio UART runs at
+// RADIO_BAUD, as configured in the modem; above the inputs' rate it drains faster than
+// one input fills. Channel 0's SRR then moves from UART0 to a PIO receiver.
+#define RADIO_BAUD 38400
+#define AUTOBAUD_RATES {38400, 4800}
+#define AUTOBAUD_BYTES 64       // bytes without a punch header before the next rate is tried
+#define AUTOBAUD_ERRORS 4       // framing errors or breaks before the next rate is tried
+
+// UART reception: 0 by interrupt (uartrx.h), 1 by DMA straight into the rx queues (dmarx.h).
+// DMA costs no CPU per byte, but can only wrap a ring of at most 32K, aligned to its size.
+// The spill to flash (SPILL_LOG_KB below) runs with DMA only: off in this default build.
+#define RX_DMA 0
+
+// Idle cores sleep until the next event (interrupt, or the other core's signal) instead of
+// spinning, to save battery. 0: spin (polled loops, for comparison)
+#define SLEEP_IDLE 1
+#define RX_DMA_POLL_US 1000     // Sleeping with RX_DMA: the DMA interrupts for no byte, so wake to look
+
+// Which channel's frame goes to the radio next (arbiter.h):
+// ARB_ROUND_ROBIN, ARB_OLDEST_FIRST, ARB_LONGEST_QUEUE or ARB_PUNCH_TIME
+#define TX_ARBITER ARB_ROUND_ROBIN
+#define MERGE_WINDOW_MS 1000    // ARB_PUNCH_TIME: longest a punch waits for earlier ones on other channels
+
+// Radio packets (pack.h): frames go to the modem in groups of whole frames, at most
+// PACKET_MAX bytes (the modem's packet payload) and PACKET_FRAMES frames, sent back to back
+// so the modem sends them in one packet, one CTS cycle. A group waits at most
+// PACKET_FLUSH_MS for more frames. Then the line stays quiet PACKET_GAP_MS, the UART's TX
+// FIFO (32 chars) and the modem's packet timeout, so the next group starts a new packet.
+// PACKET_MAX 0: each frame as soon as it is picked.
+// PACKET_ADAPTIVE 1: the flush window follows the modem's CTS (cts.h): none when the link
+// has been idle a packet cycle, and a group waits while CTS is held, to go when it comes
+// back. 0: always PACKET_FLUSH_MS.
+#define PACKET_MAX 120
+#define PACKET_FRAMES 8
+#define PACKET_FLUSH_MS 20
+#define PACKET_GAP_MS 12
+#define PACKET_ADAPTIVE 1
+
+// A punch seen again within DEDUP_WINDOW_MS (same station, card and punch time: repeated
+// by the station, or heard by a second receiver) is not sent again (dedup.h). 0: send all.
+// The cache holds DEDUP_SETS * DEDUP_WAYS punches, 16 bytes each.
+#define DEDUP_WINDOW_MS 30000
+#define DEDUP_SETS 64           // power of two
+#define DEDUP_WAYS 4
+
+// Compact radio format (wire.h): every WIRE_KEYFRAME-th punch of a station in full, the
+// others as a record of 9 to 15 bytes. The receiving computer needs the decoder, wireDecode
+// (serialBufferTest). 0: punches as received. The encoder keeps the latest keyframe of
+// WIRE_STATIONS stations (by channel), 20 bytes each; ARB_PUNCH_TIME sends records at once.
+#define WIRE_KEYFRAME 0
+#define WIRE_STATIONS 16        // power of two
+
+// Spill to flash (spill.h): while a channel's rx queue or frame queue is SPILL_HIGH percent
+// full or more, its oldest frames go to a log in the last SPILL_LOG_KB of the flash instead,
+// until all are below SPILL_LOW percent, and are sent from there, in order, before the rest.
+// The log goes round the whole region, erasing 4K sectors ahead. Above SPILL_HIGH the queues
+// still take what comes while the flash erases (45 ms, at worst 400 ms). Needs RX_DMA 1:
+// both cores wait out each erase or program, the DMA receiving meanwhile (main.c). With
+// RX_DMA 0, as shipped, the log is off whatever SPILL_LOG_KB says. 0: off, punches beyond
+// the queues are lost.
+#define SPILL_LOG_KB 1024       // multiple of 4
+#define SPILL_HIGH 50
+#define SPILL_LOW 25
+
+#define STATS_PERIOD_MS 10000   // Status report interval over USB serial
+#define LINK_WARN_S 60          // Warn over USB serial, each link sample, while an rx queue is forecast full within this (link.h)
+
+#define FRAME_MAX 128           // Longest frame (punch) assembled for tx (oversized)
+
+#endif
\ No newline at end of file
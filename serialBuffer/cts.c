@@ -0,0 +1,56 @@
+// The radio modem's CTS: hold times and their running mean
+
+#include <string.h>
+#include "cts.h"
+
+static bool watching;
+static volatile bool held;
+static volatile uint32_t sinceUs;       // the latest change
+static volatile cts_stats_t counts;
+
+void cts_init(bool watch, bool clear, uint32_t nowUs) {
+    watching = watch;
+    held = watch && !clear;
+    sinceUs = nowUs;
+    memset((void *)&counts, 0, sizeof(counts));
+}
+
+void cts_edge(bool clear, uint32_t nowUs) {
+    if (!watching || clear == !held) {              // No change: both edges came in one interrupt
+        return;
+    }
+    if (clear) {                                    // A hold ended
+        uint32_t hold = nowUs - sinceUs;
+        counts.holds++;
+        counts.lastHoldUs = hold;
+        counts.maxHoldUs = hold > counts.maxHoldUs ? hold : counts.maxHoldUs;
+        counts.sumHoldUs += hold;
+        if (counts.holds == 1) {
+            counts.meanHoldUs = hold;
+        } else {
+            counts.meanHoldUs += ((int32_t)hold - (int32_t)counts.meanHoldUs) / CTS_MEAN_WEIGHT;
+        }
+    }
+    held = !clear;
+    sinceUs = nowUs;
+}
+
+bool cts_watching(void) {
+    return watching;
+}
+
+bool cts_held(void) {
+    return held;
+}
+
+uint32_t cts_clear_for_us(uint32_t nowUs) {
+    return held ? 0 : nowUs - sinceUs;
+}
+
+uint32_t cts_mean_hold_us(void) {
+    return counts.meanHoldUs;
+}
+
+void cts_stats(cts_stats_t *stats) {
+    memcpy(stats, (const void *)&counts, sizeof(*stats));
+}
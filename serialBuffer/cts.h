@@ -0,0 +1,45 @@
+#ifndef CTS_H
+#define CTS_H
+
+// The radio modem's CTS: the TinyMesh holds it (nCTS high) while it sends a packet, the
+// packet cycle, and the UART's hardware flow control stops the line meanwhile. A GPIO
+// interrupt on both edges of the CTS pin (main.c) reports each change; this module times
+// the holds and learns their length, a running mean weighted 1/CTS_MEAN_WEIGHT to the
+// latest. Packing (pack.h) coalesces by it, link.h measures the link by it.
+// Hardware independent; the edges come in by interrupt on core0, the readers run in its
+// main loop.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CTS_MEAN_WEIGHT 8
+
+typedef struct {
+    uint32_t holds;             // times CTS was held
+    uint32_t lastHoldUs;        // how long, the latest
+    uint32_t meanHoldUs;        // the learned length, 0 before the first
+    uint32_t maxHoldUs;
+    uint64_t sumHoldUs;         // for the share of time held
+} cts_stats_t;
+
+// watch false: no edges come, CTS counts as clear and nothing is learned
+void cts_init(bool watch, bool clear, uint32_t nowUs);
+
+void cts_edge(bool clear, uint32_t nowUs);     // interrupt: CTS changed, or may have
+
+bool cts_watching(void);
+bool cts_held(void);
+uint32_t cts_clear_for_us(uint32_t nowUs);     // since CTS came back, 0 while held
+uint32_t cts_mean_hold_us(void);
+void cts_stats(cts_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
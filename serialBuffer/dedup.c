@@ -0,0 +1,64 @@
+// Duplicate punch cache, set associative with least recently seen replacement
+
+#include <string.h>
+#include "dedup.h"
+
+_Static_assert((DEDUP_SETS & (DEDUP_SETS - 1)) == 0, "DEDUP_SETS must be a power of two");
+
+typedef struct {
+    uint32_t card;
+    uint32_t time;
+    uint16_t station;
+    bool used;
+    uint32_t seenMs;            // last sighting
+} entry_t;                      // 16 bytes
+
+static entry_t cache[DEDUP_SETS][DEDUP_WAYS];
+static uint32_t window;         // [ms]
+static dedup_stats_t counts;
+
+void dedup_init(uint32_t windowMs) {
+    window = windowMs;
+    memset(cache, 0, sizeof(cache));
+    memset(&counts, 0, sizeof(counts));
+}
+
+static entry_t *set(uint16_t station, uint32_t card, uint32_t time) {
+    uint32_t h = card * 0x9E3779B1u ^ time * 0x85EBCA77u ^ station * 0xC2B2AE3Du;
+    h ^= h >> 16;                                       // the high bits into the index too
+    return cache[h & (DEDUP_SETS - 1)];
+}
+
+// Put an entry at way i first: the ways of a set are kept most recently seen first
+static void toFront(entry_t *ways, int i, entry_t e) {
+    memmove(&ways[1], &ways[0], i * sizeof(entry_t));
+    ways[0] = e;
+}
+
+bool dedup_seen(uint16_t station, uint32_t card, uint32_t time, uint32_t nowMs) {
+    if (window == 0) {
+        return false;
+    }
+    entry_t *ways = set(station, card, time);
+    int victim = DEDUP_WAYS - 1;                        // the least recently seen, if all live
+    counts.punches++;
+    for (int way=0; way<DEDUP_WAYS; way++) {
+        entry_t e = ways[way];
+        if (!e.used || nowMs - e.seenMs >= window) {    // Free or expired
+            victim = way < victim ? way : victim;
+        } else if (e.card == card && e.time == time && e.station == station) {
+            e.seenMs = nowMs;
+            toFront(ways, way, e);
+            counts.duplicates++;
+            return true;
+        }
+    }
+    entry_t *e = &ways[victim];
+    counts.evicted += e->used && nowMs - e->seenMs < window;
+    toFront(ways, victim, (entry_t){card, time, station, true, nowMs});
+    return false;
+}
+
+void dedup_stats(dedup_stats_t *stats) {
+    *stats = counts;
+}
@@ -0,0 +1,39 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+// Duplicate punch suppression: SRR stations repeat their punches, and a second receiver
+// hears the same ones, but the radio link only needs each punch once. A cache of the
+// punches seen, keyed on station code, card number and punch time, tells the framer which
+// ones it had already within the time window; those are dropped before the frame queue.
+// Set associative: a hash of the key picks a set of DEDUP_WAYS entries, so a punch costs
+// the same whatever is cached. An entry lives DEDUP_WINDOW_MS from its last sighting; a
+// full set makes room by its least recently seen entry.
+// Runs on core1 (framer.c), for all channels together.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t punches;           // punches looked up
+    uint32_t duplicates;        // found within the window: dropped
+    uint32_t evicted;           // entries replaced within their window, the cache too small
+} dedup_stats_t;
+
+void dedup_init(uint32_t windowMs);     // before the framer starts; 0: nothing is a duplicate
+
+// True if the punch was seen within the window; records it either way.
+// time: the TD, TH, TL and TSS bytes, as received.
+bool dedup_seen(uint16_t station, uint32_t card, uint32_t time, uint32_t nowMs);
+
+void dedup_stats(dedup_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
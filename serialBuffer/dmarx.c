@@ -0,0 +1,42 @@
+// DMA driven UART reception, hardware independent part.
+// dmarx_poll runs in core1's loop as the producer of the rx queue, on behalf of the DMA.
+
+#include "dmarx.h"
+#include "ring.h"
+
+static const dmarx_port_t *dmaPort;
+static uint32_t lastCount[Nchannels];       // transfer count at the previous poll
+static uartrx_stats_t rxStats[Nchannels];
+
+void dmarx_init(const dmarx_port_t *port) {
+    dmaPort = port;
+    for (int chan=0; chan<Nchannels; chan++) {
+        lastCount[chan] = DMARX_COUNT;
+    }
+}
+
+size_t dmarx_poll(int chan) {
+    uartrx_stats_t *s = &rxStats[chan];
+    uint32_t count = dmaPort->transferCount(chan);
+    uint32_t written = lastCount[chan] - count;     // counts down, so modulo 2^32 is fine
+    uint32_t errors = dmaPort->lineErrors(chan);
+
+    if (errors) {
+        s->overruns += (errors & UARTRX_OE) != 0;
+        s->breaks += (errors & UARTRX_BE) != 0;
+        s->framingErrors += (errors & UARTRX_FE) != 0;
+        s->parityErrors += (errors & UARTRX_PE) != 0;
+    }
+    if (written == 0) {
+        return 0;
+    }
+    lastCount[chan] = count;
+    s->irqs++;
+    s->bytes += written;
+    rxq_produce_overwriting(chan, written);         // Overwritten bytes are counted by the rx queue
+    return written;
+}
+
+void dmarx_stats(int chan, uartrx_stats_t *stats) {
+    *stats = rxStats[chan];
+}
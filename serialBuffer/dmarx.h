@@ -0,0 +1,43 @@
+#ifndef DMARX_H
+#define DMARX_H
+
+// DMA driven UART reception.
+// A DMA channel per UART, paced by the UART's RX DREQ, copies each received character into
+// the channel's rx queue storage (rxq_storage), wrapping at its end (DMA ring mode). No CPU
+// runs per character; instead the main loop calls dmarx_poll, which derives how far the DMA
+// has written from its transfer count and publishes that to the rx queue. The DMA never
+// waits for the reader: bytes it writes over unsent ones are counted as rx queue drops,
+// and skipped by the framing and the transmitter (frameq.h).
+// Only characters reach the storage; a break arrives as a 0 byte.
+// The DMA and UART registers are reached through a port (main.c on the Pico, a simulated
+// DMA channel in the host tests).
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "uartrx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Transfer count a receive DMA channel is started with. It counts down once per character,
+// 2^32 characters lasts 13 days at 38400 baud, so it is never re-armed.
+#define DMARX_COUNT 0xFFFFFFFFu
+
+typedef struct {
+    uint32_t (*transferCount)(int chan);    // remaining transfers of the channel's DMA
+    uint32_t (*lineErrors)(int chan);       // UARTRX_FE/PE/BE/OE seen since the last call
+} dmarx_port_t;
+
+void dmarx_init(const dmarx_port_t *port);  // the DMA channels started with DMARX_COUNT
+size_t dmarx_poll(int chan);                // publish received bytes, returns their count
+// Reception counters in the interrupt driven layout. The line errors are sampled per poll,
+// so they count polls that saw an error; irqs counts polls that found data.
+void dmarx_stats(int chan, uartrx_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,38 +1,163 @@
-// A simple fifo queue (or ring buffer) in c.
-// This implementation \should be\ "thread safe" for single producer/consumer with atomic writes of size_t.
-// This is because the head and tail "pointers" are only written by the producer and consumer respectively.
-// Demonstrated with void pointers and no memory management.
+// A simple fifo queue (or ring buffer) of bytes in c.
+// Lock-free for a single producer and a single consumer, e.g. a UART IRQ handler (or core1)
+// writing and the main loop (or core0) reading. No critical sections are needed because
+// the head and tail "pointers" are only written by the producer and consumer respectively:
+//  - The producer stores the data byte(s), then publishes head with release ordering.
+//  - The consumer loads head with acquire ordering before reading the data, and releases
+//    the slots by storing tail with release ordering; the producer loads tail with acquire.
+// On the Cortex-M0+ the accesses are plain word loads/stores with a DMB barrier; on a host
+// the same code orders the data between cores (see serialBufferTest/fifoTest.c).
+// Each side reloads the other side's index only when its cached copy says full/empty.
+// Elements are stored as bytes in caller supplied (static) storage, no memory management.
+// Read and peek return -1 on an empty queue, so a 0x00 byte is not mistaken for "empty".
 // Note that empty is head==tail, thus only QUEUE_SIZE-1 entries may be used.
 // https://gist.github.com/ryankurte
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "fifo.h"
 
-void* queue_read(queue_t *queue) {
-    if (queue->tail == queue->head) {
-        return NULL;
+#define LOAD_RELAXED(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define LOAD_ACQUIRE(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+// Consumer: true if at least one byte is readable, refreshing the cached head if needed
+static inline int queue_readable(queue_t *queue, size_t tail) {
+    if (tail == queue->headCache) {
+        queue->headCache = LOAD_ACQUIRE(&queue->head);
     }
-    void* handle = queue->data[queue->tail];
-    queue->data[queue->tail] = NULL;
-    queue->tail = (queue->tail + 1) % queue->size;
-    return handle;
+    return tail != queue->headCache;
 }
 
-// Peek: get the tail item without pointer update
-void* queue_peek(queue_t *queue) {
-    if (queue->tail == queue->head) {
-        return NULL;
+int queue_read(queue_t *queue, uint8_t *item) {
+    size_t tail = LOAD_RELAXED(&queue->tail);
+    if (!queue_readable(queue, tail)) {
+        return -1;
     }
-    void* handle = queue->data[queue->tail];
-    return handle;
+    *item = queue->data[tail];
+    STORE_RELEASE(&queue->tail, (tail + 1) % queue->size);
+    return 0;
 }
 
-int queue_write(queue_t *queue, void* handle) {
-    if (((queue->head + 1) % queue->size) == queue->tail) {
+// Peek: get the tail item without pointer update
+int queue_peek(queue_t *queue, uint8_t *item) {
+    size_t tail = LOAD_RELAXED(&queue->tail);
+    if (!queue_readable(queue, tail)) {
         return -1;
     }
-    queue->data[queue->head] = handle;
-    queue->head = (queue->head + 1) % queue->size;
+    *item = queue->data[tail];
+    return 0;
+}
+
+int queue_write(queue_t *queue, uint8_t item) {
+    size_t head = LOAD_RELAXED(&queue->head);
+    size_t next = (head + 1) % queue->size;
+    if (next == queue->tailCache) {
+        queue->tailCache = LOAD_ACQUIRE(&queue->tail);
+        if (next == queue->tailCache) {
+            return -1;
+        }
+    }
+    queue->data[head] = item;
+    STORE_RELEASE(&queue->head, next);
     return 0;
+}
+
+size_t queue_count(queue_t *queue) {
+    size_t head = LOAD_ACQUIRE(&queue->head);
+    size_t tail = LOAD_ACQUIRE(&queue->tail);
+    return (head + queue->size - tail) % queue->size;
+}
+
+size_t queue_space(queue_t *queue) {
+    return queue->size - 1 - queue_count(queue);
+}
+
+// Readable region: from tail up to head, split at the end of the storage
+size_t queue_read_spans(queue_t *queue, queue_span_t span[2]) {
+    size_t head = queue->headCache = LOAD_ACQUIRE(&queue->head);
+    size_t tail = LOAD_RELAXED(&queue->tail);
+    span[0].data = &queue->data[tail];
+    span[1].data = queue->data;
+    if (head >= tail) {
+        span[0].len = head - tail;
+        span[1].len = 0;
+    } else {
+        span[0].len = queue->size - tail;
+        span[1].len = head;
+    }
+    return span[0].len + span[1].len;
+}
+
+void queue_consume(queue_t *queue, size_t n) {
+    assert(n <= queue_count(queue));
+    STORE_RELEASE(&queue->tail, (LOAD_RELAXED(&queue->tail) + n) % queue->size);
+}
+
+// Writable region: from head up to the slot before tail, split at the end of the storage
+size_t queue_write_spans(queue_t *queue, queue_span_t span[2]) {
+    size_t head = LOAD_RELAXED(&queue->head);
+    size_t tail = queue->tailCache = LOAD_ACQUIRE(&queue->tail);
+    span[0].data = &queue->data[head];
+    span[1].data = queue->data;
+    if (tail > head) {
+        span[0].len = tail - head - 1;
+        span[1].len = 0;
+    } else if (tail == 0) {
+        span[0].len = queue->size - head - 1;
+        span[1].len = 0;
+    } else {
+        span[0].len = queue->size - head;
+        span[1].len = tail - 1;
+    }
+    return span[0].len + span[1].len;
+}
+
+void queue_produce(queue_t *queue, size_t n) {
+    assert(n <= queue_space(queue));
+    STORE_RELEASE(&queue->head, (LOAD_RELAXED(&queue->head) + n) % queue->size);
+}
+
+size_t queue_read_n(queue_t *queue, uint8_t *dst, size_t n) {
+    queue_span_t span[2];
+    size_t avail = queue_read_spans(queue, span);
+    if (n > avail) {
+        n = avail;
+    }
+    size_t first = (n < span[0].len) ? n : span[0].len;
+    memcpy(dst, span[0].data, first);
+    memcpy(dst + first, span[1].data, n - first);
+    queue_consume(queue, n);
+    return n;
+}
+
+size_t queue_write_n(queue_t *queue, const uint8_t *src, size_t n) {
+    queue_span_t span[2];
+    size_t avail = queue_write_spans(queue, span);
+    if (n > avail) {
+        n = avail;
+    }
+    size_t first = (n < span[0].len) ? n : span[0].len;
+    memcpy(span[0].data, src, first);
+    memcpy(span[1].data, src + first, n - first);
+    queue_produce(queue, n);
+    return n;
+}
+
+// Move up to n bytes between queues, one memcpy per readable span
+size_t queue_move(queue_t *dst, queue_t *src, size_t n) {
+    queue_span_t span[2];
+    size_t moved = 0;
+    queue_read_spans(src, span);
+    for (int i=0; i<2 && moved<n; i++) {
+        size_t len = (n - moved < span[i].len) ? n - moved : span[i].len;
+        size_t done = queue_write_n(dst, span[i].data, len);
+        moved += done;
+        if (done < len) {
+            break;      // dst full
+        }
+    }
+    queue_consume(src, moved);
+    return moved;
 }
\ No newline at end of file
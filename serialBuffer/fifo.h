@@ -2,16 +2,72 @@
 #define FIFO_H
 
 #include <stdlib.h>
+#include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Alignment of the producer and consumer halves of a queue.
+// The RP2040 has no data cache, so word alignment is enough there;
+// host builds set 64 to keep the two ends on separate cache lines.
+#ifndef QUEUE_LINE_SIZE
+#define QUEUE_LINE_SIZE 4
+#endif
+#define QUEUE_ALIGNED __attribute__((aligned(QUEUE_LINE_SIZE)))
+
+// Lock-free single producer / single consumer byte queue.
+// The storage array is owned by the caller and is normally
+// a static array, so the buffer is reserved at link time rather than malloc'd.
+// head is written only by the producer, tail only by the consumer. Each side
+// keeps a cached copy of the other side's index and reloads it only when the
+// cached value says the queue is full (empty), so the shared indices are rarely touched.
 typedef struct {
-    size_t head;
-    size_t tail;
-    size_t size;
-    void** data;
+    size_t head QUEUE_ALIGNED;  // producer: next slot to write
+    size_t tailCache;           // producer: last tail seen
+    size_t tail QUEUE_ALIGNED;  // consumer: next slot to read
+    size_t headCache;           // consumer: last head seen
+    size_t size QUEUE_ALIGNED;
+    uint8_t *data;
 } queue_t;
 
-void* queue_read(queue_t *queue);
-void* queue_peek(queue_t *queue); // get item without pointer update
-int queue_write(queue_t *queue, void* handle);
+// Static initialiser for a queue over a byte array, e.g.
+//   static uint8_t storage[1024];
+//   queue_t queue = QUEUE_INIT(storage);
+#define QUEUE_INIT(storage) {.size = sizeof(storage), .data = (storage)}
+
+// A contiguous run of bytes inside the queue storage.
+// The readable (or writable) region is at most two spans: up to the end of
+// the storage, and the wrapped remainder from its start.
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} queue_span_t;
+
+// Consumer side
+int queue_read(queue_t *queue, uint8_t *item);
+int queue_peek(queue_t *queue, uint8_t *item); // get item without pointer update
+// Producer side
+int queue_write(queue_t *queue, uint8_t item);
+
+// Either side; the result is a snapshot that the other side may change
+size_t queue_count(queue_t *queue); // bytes ready to read
+size_t queue_space(queue_t *queue); // bytes free for writing
+
+// Bulk copy, returns the number of bytes actually moved (less than n when empty/full)
+size_t queue_read_n(queue_t *queue, uint8_t *dst, size_t n);
+size_t queue_write_n(queue_t *queue, const uint8_t *src, size_t n);
+size_t queue_move(queue_t *dst, queue_t *src, size_t n); // consumer of src, producer of dst
+
+// Zero copy access: fill span[2] with the readable (writable) region and return its total length,
+// then release (publish) the bytes actually used with queue_consume (queue_produce).
+size_t queue_read_spans(queue_t *queue, queue_span_t span[2]);
+void queue_consume(queue_t *queue, size_t n);
+size_t queue_write_spans(queue_t *queue, queue_span_t span[2]);
+void queue_produce(queue_t *queue, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
\ No newline at end of file
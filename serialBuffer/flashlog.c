@@ -0,0 +1,155 @@
+// Log in flash, a ring of pages written and read in order
+
+#include <string.h>
+#include "flashlog.h"
+
+#define SECTOR_PAGES (FLASHLOG_SECTOR / FLASHLOG_PAGE)
+#define ERASE_AHEAD 2           // sectors erased ahead of the writer
+
+static const flashlog_port_t *port;
+static uint32_t pages;          // in the region, 0: off
+static uint32_t seq;            // sequence number of the next page filled
+// Free running page counts, the region position modulo pages: [readTo, written) are in
+// flash, then come the sealed pages in RAM, then the one filling. Up to erasedTo is erased.
+static uint32_t readTo, written, erasedTo;
+static uint8_t buf[FLASHLOG_BUFFERS][FLASHLOG_PAGE];
+static int first;               // buffer of page written
+static int sealed;              // buffers sealed, from first on
+static size_t fill;             // bytes in the page filling, 0 if none
+static flashlog_stats_t counts;
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t offsetOf(uint32_t page) {
+    return page % pages * FLASHLOG_PAGE;
+}
+
+// Is the sector from page erased?
+static bool blank(uint32_t page) {
+    for (uint32_t p=page; p<page + SECTOR_PAGES; p++) {
+        port->read(offsetOf(p), buf[0], FLASHLOG_PAGE);
+        for (int i=0; i<FLASHLOG_PAGE; i++) {
+            if (buf[0][i] != 0xFF) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void flashlog_init(const flashlog_port_t *p, uint32_t size) {
+    port = p;
+    pages = size / FLASHLOG_SECTOR * SECTOR_PAGES;
+    first = sealed = 0;
+    fill = 0;
+    memset(&counts, 0, sizeof(counts));
+    if (pages == 0) {
+        return;
+    }
+    uint32_t start = 0, newest = 0;
+    bool found = false;
+    for (uint32_t page=0; page<pages; page+=SECTOR_PAGES) {         // The newest sector written
+        uint8_t head[FLASHLOG_HEAD];
+        port->read(offsetOf(page), head, sizeof(head));
+        uint32_t s = get32(head);
+        if (s != UINT32_MAX && (!found || (int32_t)(s - newest) > 0)) {
+            newest = s;
+            start = (page + SECTOR_PAGES) % pages;
+            found = true;
+        }
+    }
+    seq = found ? newest + SECTOR_PAGES : 0;                        // Past its pages
+    readTo = written = erasedTo = start;
+    while (erasedTo < start + ERASE_AHEAD * SECTOR_PAGES && blank(erasedTo)) {  // Erased ahead before
+        erasedTo += SECTOR_PAGES;
+    }
+}
+
+bool flashlog_on(void) {
+    return pages > 0;
+}
+
+size_t flashlog_pages(void) {
+    return written + sealed + (fill > 0) - readTo;
+}
+
+uint8_t *flashlog_reserve(size_t len) {
+    if (pages == 0 || FLASHLOG_HEAD + len > FLASHLOG_PAGE) {
+        return NULL;
+    }
+    if (fill + len > FLASHLOG_PAGE) {
+        flashlog_seal();
+    }
+    uint8_t *page = buf[(first + sealed) % FLASHLOG_BUFFERS];
+    if (fill == 0) {                                    // Start a page
+        if (sealed == FLASHLOG_BUFFERS) {
+            counts.behind++;
+            return NULL;
+        }
+        if (written + sealed + 1 - readTo > pages - SECTOR_PAGES) {  // Its sector not yet read
+            counts.full++;
+            return NULL;
+        }
+        memset(page, 0xFF, FLASHLOG_PAGE);
+        page[0] = seq;
+        page[1] = seq >> 8;
+        page[2] = seq >> 16;
+        page[3] = seq >> 24;
+        seq++;
+        fill = FLASHLOG_HEAD;
+        uint32_t inLog = flashlog_pages();
+        counts.maxPages = inLog > counts.maxPages ? inLog : counts.maxPages;
+    }
+    uint8_t *at = page + fill;
+    fill += len;
+    return at;
+}
+
+void flashlog_seal(void) {
+    if (fill > 0) {
+        sealed++;
+        fill = 0;
+    }
+}
+
+// Erase the next sector: the writer near, and the sector read
+static bool eraseDue(void) {
+    return erasedTo < written + ERASE_AHEAD * SECTOR_PAGES && erasedTo + SECTOR_PAGES <= readTo + pages;
+}
+
+void flashlog_poll(void) {
+    if (pages == 0 || port->busy()) {
+        return;
+    }
+    if (sealed > 0 && written < erasedTo) {
+        port->program(offsetOf(written), buf[first]);
+        first = (first + 1) % FLASHLOG_BUFFERS;
+        sealed--;
+        written++;
+        counts.programs++;
+    } else if (eraseDue()) {
+        port->erase(offsetOf(erasedTo));
+        erasedTo += SECTOR_PAGES;
+        counts.erases++;
+    }
+}
+
+bool flashlog_idle(void) {
+    return pages == 0 || (sealed == 0 && !eraseDue() && !port->busy());
+}
+
+bool flashlog_read(uint8_t page[FLASHLOG_PAGE]) {
+    if (pages == 0 || readTo == written || port->busy()) {
+        return false;
+    }
+    port->read(offsetOf(readTo), page, FLASHLOG_PAGE);
+    readTo++;
+    return true;
+}
+
+void flashlog_stats(flashlog_stats_t *stats) {
+    *stats = counts;
+    stats->pages = pages ? flashlog_pages() : 0;
+}
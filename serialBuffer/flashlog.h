@@ -0,0 +1,68 @@
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+// Log in flash: a ring of FLASHLOG_PAGE byte pages over a region of 4K erase sectors,
+// written in order and read back in order, each page once. The writer fills a page in RAM
+// (flashlog_reserve) and seals it when full; sealed pages are programmed one at a time, and
+// ERASE_AHEAD sectors ahead of the writer are kept erased, from the start on, so the first
+// frames spilled need not wait for an erase. Writing goes round the whole region, so every
+// sector is erased as often as any other: the wear is levelled without a map. A page starts
+// with its sequence number; at start the writer goes on from the sector after the newest
+// page, so the levelling holds over restarts too (sectors found blank there are not erased
+// again). The contents do not: the log starts empty.
+// Flash is reached through a port (main.c on the Pico, a simulated flash in the host
+// tests) whose erase and program start the operation, or do it and return when done (the
+// Pico's, running from that flash); flashlog_poll starts the next one once the flash is no
+// longer busy, one operation per call.
+// Hardware independent; runs in the main loop on core0.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASHLOG_PAGE 256
+#define FLASHLOG_SECTOR 4096
+#define FLASHLOG_HEAD 4         // the page's sequence number
+#define FLASHLOG_BUFFERS 4      // pages in RAM: the one filling and those sealed, not yet programmed
+
+typedef struct {
+    void (*erase)(uint32_t offset);                         // (start) erasing the sector at offset
+    void (*program)(uint32_t offset, const uint8_t *page);  // (start) programming a page, data taken at once
+    bool (*busy)(void);                                     // an erase or program going on
+    void (*read)(uint32_t offset, uint8_t *data, size_t len); // not while busy
+} flashlog_port_t;
+
+typedef struct {
+    uint32_t programs;          // pages programmed
+    uint32_t erases;            // sectors erased
+    uint32_t pages;             // pages written, not yet read: sealed, programmed, and the one filling
+    uint32_t maxPages;
+    uint32_t full;              // reservations refused, the log full
+    uint32_t behind;            // reservations refused, every RAM page sealed and waiting for the flash
+} flashlog_stats_t;
+
+// size bytes of flash from offset 0 of the port, a multiple of FLASHLOG_SECTOR, 0: off
+void flashlog_init(const flashlog_port_t *port, uint32_t size);
+bool flashlog_on(void);
+
+// Writer
+uint8_t *flashlog_reserve(size_t len);      // len bytes in the page filling, NULL if no room now
+void flashlog_seal(void);                   // the page filling may go to flash as it is
+void flashlog_poll(void);                   // start the next erase or program, when not busy
+bool flashlog_idle(void);                   // nothing to program or erase ahead
+
+// Reader
+size_t flashlog_pages(void);                // pages not yet read, including those still in RAM
+bool flashlog_read(uint8_t page[FLASHLOG_PAGE]); // the oldest page in flash, false if none yet or busy
+
+void flashlog_stats(flashlog_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+// Frame queue, descriptors of the frames in the rx queues.
+// The producer (framer) and the consumer (transmitter) each keep a free running rx queue
+// index of the next frame's first byte; the descriptor ring (fq in ring.h) keeps them in
+// step. The rx queue's own tail only moves when a frame is released, so received bytes
+// stay in place until the transmitter is done with them. Frames may be released out of the
+// order read: the tail only moves up to the oldest one still in flight, so that keeps its
+// bytes.
+
+#include <string.h>
+#include "frameq.h"
+
+_Static_assert(RX_QUEUE_SIZE <= 0x10000, "frame offsets are 16 bits");
+
+static struct {
+    size_t framed;              // producer: rx index after the last frame published
+    uint32_t frames;            // producer
+    uint32_t skipped;           // producer
+    uint32_t dropped;           // producer
+    uint32_t unordered;         // producer: frames without an order entry
+    size_t next;                // consumer: rx index of the next frame
+    uint32_t starts[FRAMEQ_IN_FLIGHT]; // consumer: rx index of each frame in flight, in order
+    int inFlight;               // consumer: frames read, not yet released
+    uint32_t releasedTo;        // consumer: rx index after the newest frame released
+    uint32_t overwritten;       // consumer
+} frameq[Nchannels];
+static bool ordered;            // record the publishing order (fqorder)
+
+static bool push(int chan, uint32_t arrival, size_t len) {
+    fq_desc_t desc = {arrival, frameq[chan].framed & (RX_QUEUE_SIZE - 1), len};
+    if (!fq_put(chan, desc)) {
+        return false;
+    }
+    frameq[chan].framed += desc.len ? desc.len : arrival;
+    return true;
+}
+
+bool frameq_commit(int chan, size_t len, uint32_t arrival) {
+    if (len == 0 || len > FRAME_MAX || !push(chan, arrival, len)) {
+        return false;
+    }
+    frameq[chan].frames++;
+    if (ordered && !fqorder_put(0, chan)) {     // Full only after lost frames left entries behind
+        frameq[chan].unordered++;
+    }
+    return true;
+}
+
+bool frameq_skip(int chan, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+    if (!push(chan, len, 0)) {
+        return false;
+    }
+    frameq[chan].skipped += len;
+    return true;
+}
+
+bool frameq_drop(int chan, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+    if (!push(chan, len, 0)) {
+        return false;
+    }
+    frameq[chan].dropped += len;
+    return true;
+}
+
+size_t frameq_count(int chan) {
+    return fq_count(chan);
+}
+
+// Bytes up to index are done with: free them now, or with the frames still being sent
+static void passed(int chan, size_t index) {
+    frameq[chan].next = index;
+    if (frameq[chan].inFlight == 0) {
+        rxq_consume_to(chan, index);
+    }
+}
+
+bool frameq_read(int chan, frame_t *frame, ring_span_t data[2]) {
+    fq_desc_t desc;
+    if (frameq[chan].inFlight == FRAMEQ_IN_FLIGHT) {
+        return false;
+    }
+    while (fq_get(chan, &desc)) {
+        size_t start = frameq[chan].next;
+        if (desc.len == 0) {                                // Skip
+            passed(chan, start + desc.arrival);
+            continue;
+        }
+        if (rxq_read_spans_from(chan, start, data) > RX_QUEUE_SIZE) {   // Overwritten by the DMA
+            frameq[chan].overwritten += desc.len;
+            passed(chan, start + desc.len);
+            continue;
+        }
+        frame->arrival = desc.arrival;
+        frame->chan = chan;
+        frame->len = desc.len;
+        frame->offset = desc.offset;
+        frame->end = start + desc.len;
+        frame->spilled = false;
+        if (data[0].len > desc.len) {                       // Just the frame
+            data[0].len = desc.len;
+        }
+        data[1].len = desc.len - data[0].len;
+        frameq[chan].next = frame->end;
+        frameq[chan].starts[frameq[chan].inFlight++] = start;
+        return true;
+    }
+    return false;
+}
+
+void frameq_release(const frame_t *frame) {
+    int chan = frame->chan;
+    uint32_t start = frame->end - frame->len;
+    int i = 0;
+    while (i < frameq[chan].inFlight - 1 && frameq[chan].starts[i] != start) {
+        i++;
+    }
+    frameq[chan].inFlight--;
+    memmove(&frameq[chan].starts[i], &frameq[chan].starts[i + 1],
+            (frameq[chan].inFlight - i) * sizeof(frameq[chan].starts[0]));
+    if ((int32_t)(frame->end - frameq[chan].releasedTo) > 0) {
+        frameq[chan].releasedTo = frame->end;
+    }
+    if (i > 0) {                                        // An older one still in flight
+        return;
+    }
+    // Up to the oldest frame still in flight, newer ones released before go now. Skipped
+    // bytes behind the last frame in flight go with it.
+    uint32_t to = frameq[chan].releasedTo;
+    if (frameq[chan].inFlight && (int32_t)(to - frameq[chan].starts[0]) > 0) {
+        to = frameq[chan].starts[0];
+    }
+    rxq_consume_to(chan, frameq[chan].inFlight ? to : frameq[chan].next);
+}
+
+int frameq_in_flight(int chan) {
+    return frameq[chan].inFlight;
+}
+
+void frameq_order(bool record) {
+    ordered = record;
+}
+
+int frameq_oldest(void) {
+    uint8_t chan;
+    return fqorder_peek(0, &chan) ? chan : -1;
+}
+
+void frameq_oldest_taken(void) {
+    uint8_t chan;
+    fqorder_get(0, &chan);
+}
+
+uint32_t frameq_unordered(int chan) {
+    return frameq[chan].unordered;
+}
+
+void frameq_stats(int chan, frameq_stats_t *stats) {
+    stats->frames = frameq[chan].frames;
+    stats->skipped = frameq[chan].skipped;
+    stats->dropped = frameq[chan].dropped;
+    stats->overwritten = frameq[chan].overwritten;
+}
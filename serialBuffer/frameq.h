@@ -0,0 +1,71 @@
+#ifndef FRAMEQ_H
+#define FRAMEQ_H
+
+// Frame queue: complete punches (or other frames) waiting for transmission,
+// one queue per input channel. The frame bytes stay where they were received, in the
+// channel's rx queue; the frame queue holds a descriptor per frame (fq_desc_t in ring.h).
+// Frames tile the received stream: each starts where the previous one ended.
+// The framing code (producer) publishes a frame once it is complete, so several punches
+// per channel can wait ready at the same time. The transmitter (consumer) sends the bytes
+// straight from the rx queue storage and releases them once they are sent, in any order: a
+// frame's bytes are freed once it and every frame read before it are released. At most
+// FRAMEQ_IN_FLIGHT frames per channel are read and not yet released.
+// Bytes the rx DMA overwrote before they were sent are skipped, never sent, as are the
+// bytes the framer drops (duplicate punches, the rest of a punch sent as a record).
+// On request the queue also records the channel of each frame published, in publishing
+// order, so the transmitter can take frames oldest first across channels (arbiter.h).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAMEQ_IN_FLIGHT 32     // per channel: frames picked, not yet copied out (pack.h, spill.h)
+
+typedef struct {
+    uint32_t arrival;           // time the frame was completed [us since boot]
+    uint8_t chan;               // input channel
+    uint8_t len;                // frame length in bytes, at most FRAME_MAX
+    uint16_t offset;            // first byte in the rx queue storage, spilled: the page read back
+    uint32_t end;               // rx queue index after the last byte, see frameq_release
+    bool spilled;               // read back from the flash log (spill.h), no longer in the rx queue
+} frame_t;
+
+typedef struct {
+    uint32_t frames;            // producer: frames published
+    uint32_t skipped;           // producer: bytes lost before they were framed
+    uint32_t dropped;           // producer: bytes not to be sent
+    uint32_t overwritten;       // consumer: frame bytes lost before they were sent
+} frameq_stats_t;
+
+// Producer side, the framer: the next len bytes of the channel's stream
+bool frameq_commit(int chan, size_t len, uint32_t arrival);   // a frame, false if no room
+bool frameq_skip(int chan, size_t len);                       // lost bytes, false if no room
+bool frameq_drop(int chan, size_t len);                       // bytes not to send, the same
+
+// Consumer side, the transmitter
+size_t frameq_count(int chan);                                // frames waiting (and skips)
+bool frameq_read(int chan, frame_t *frame, ring_span_t data[2]); // pop the oldest frame, its bytes
+                                                              // (false too at FRAMEQ_IN_FLIGHT)
+void frameq_release(const frame_t *frame);                    // sent: free its rx queue space
+int frameq_in_flight(int chan);                               // frames read, not yet released
+
+// Publishing order across channels, before the producer starts
+void frameq_order(bool record);
+int frameq_oldest(void);        // channel of the oldest frame not yet taken, -1 if none;
+                                // a frame lost before it was read leaves its entry behind
+void frameq_oldest_taken(void); // done with that entry, the next one comes up
+uint32_t frameq_unordered(int chan);    // frames published without an entry, none fitted
+
+void frameq_stats(int chan, frameq_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
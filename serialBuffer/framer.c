@@ -0,0 +1,319 @@
+// Punch framing, hardware independent part.
+
+#include <string.h>
+#include "framer.h"
+#include "frameq.h"
+#include "timebase.h"
+#include "sicrc.h"
+#include "dedup.h"
+#include "wire.h"
+
+// Definitions of the punch format
+// Documentation: PC programmer's guide and SISRR1AP serial data record
+// Each punch is a sequence of 17 to 18 chars
+// Starting with an (optional) constant preamble byte, a constant header byte
+// and a length byte (always 13), then "length" payload bytes and two CRC bytes
+// (over header, length and payload), then an ETX after an STX.
+// We transfer all chars, but use the header and length to assemble complete punches for tx
+// The length byte is respected to allow for future formats
+// We attempt to transfer all data, even when the above format is not maintained.
+static const uint8_t STX      = 0x02;   // STX, constant preamble of punch (only in "new" format?)
+static const uint8_t ETX      = 0x03;   // ETX, end of a punch that started with STX
+static const uint8_t punchHdr = 0xD3;   // 211, Constant first byte of every punch
+static const uint8_t punchLen = 13;     // Payload length of a punch
+// Positions from the header: CN1 CN0 station code, SN3..SN0 card number, TD day of week
+// (bit5..4 week counter, bit3..1 day, bit0 pm), TH TL seconds in the half day, TSS 1/256 s
+enum {posCN = 2, posSN = 4, posTD = 8, posTH, posTL, posTSS};
+
+// States of the punch assembly process:
+// Look for a header, get the payload length, move the payload, queue the punch for tx
+enum states {stateHeader, stateLength, statePayload, stateReady};
+
+static struct {
+    int state;
+    int txLength;       // chars in the frame so far (header search), then chars still to come
+    int stxetx;         // STX/ETX delimiters used in punch
+    uint8_t last;       // last char of the frame, to see an STX before the header
+    size_t start;       // rx queue index of the frame's first char
+    size_t cursor;      // rx queue index of the next char to look at
+    size_t hdr;         // rx queue index of the header
+    uint8_t length;     // its length byte: punchLen for a punch
+    uint16_t crc;       // CRC register over the header, length and payload so far
+    int crcCount;       // chars the CRC covers
+    int crcLeft;        // of them still to come
+    uint8_t tail[3];    // CRC and ETX as received
+    int tailLen;
+    int dropTail;       // chars at the frame's end not to send: a duplicate punch, or what
+                        // its record saved (wire.h)
+    framer_stats_t stats;
+} framer[Nchannels];
+
+// The chars from the cursor on, returns their count
+static size_t unseen(int chan, ring_span_t span[2]) {
+    return rxq_read_spans_from(chan, framer[chan].cursor, span);
+}
+
+static uint8_t frameByte(const ring_span_t data[2], size_t i) {
+    return i < data[0].len ? data[0].data[i] : data[1].data[i - data[0].len];
+}
+
+// Take the chars up to and including the next header (at most limit) into the frame.
+// Returns the count taken; *found tells if the last one is a header.
+static size_t scanHeader(int chan, size_t limit, bool *found) {
+    ring_span_t span[2];
+    *found = false;
+    if (unseen(chan, span) == 0) {
+        return 0;
+    }
+    size_t n = span[0].len < limit ? span[0].len : limit;   // Up to the wrap, the next call goes on
+    const uint8_t *hdr = memchr(span[0].data, punchHdr, n);
+    if (hdr) {
+        n = hdr - span[0].data + 1;
+        *found = true;
+    }
+    uint8_t prev = n >= 2 ? span[0].data[n - 2] : framer[chan].last;
+    framer[chan].stxetx = (prev == STX);
+    framer[chan].last = span[0].data[n - 1];
+    framer[chan].cursor += n;
+    return n;
+}
+
+// Start over behind bytes the rx DMA overwrote before they were framed (see dmarx.h)
+static void skipLost(int chan, size_t avail) {
+    size_t oldest = framer[chan].cursor + avail - RX_QUEUE_SIZE;
+    if (frameq_skip(chan, oldest - framer[chan].start)) {
+        framer[chan].start = framer[chan].cursor = oldest;
+        framer[chan].txLength = 0;
+        framer[chan].last = 0;
+        framer[chan].dropTail = 0;
+        framer[chan].state = stateHeader;
+    }
+}
+
+// The length byte is in: start the CRC, payload and tail to come
+static void startPunch(int chan, uint8_t len) {
+    framer[chan].crc = sicrc_byte(sicrc_byte(0, punchHdr), len);
+    framer[chan].crcCount = len + 2;
+    framer[chan].crcLeft = len;
+    framer[chan].tailLen = 0;
+}
+
+// Take n payload chars: into the CRC, then the tail
+static void takePayload(int chan, const ring_span_t span[2], size_t n) {
+    for (size_t i=0; i<n; i++) {
+        uint8_t c = frameByte(span, i);
+        if (framer[chan].crcLeft > 0) {
+            framer[chan].crc = sicrc_byte(framer[chan].crc, c);
+            framer[chan].crcLeft--;
+        } else {
+            framer[chan].tail[framer[chan].tailLen++] = c;
+        }
+    }
+}
+
+static bool punchValid(int chan) {
+    uint16_t crc = sicrc_end(framer[chan].crc, framer[chan].crcCount);
+    return framer[chan].tail[0] == crc >> 8 && framer[chan].tail[1] == (crc & 0xFF) &&
+           (!framer[chan].stxetx || framer[chan].tail[2] == ETX);
+}
+
+// A valid punch (length punchLen, so the fields are there): seen before?
+static bool seenBefore(int chan) {
+    ring_span_t span[2];
+    uint32_t field[3] = {0, 0, 0};                  // station, card, time
+    const int from[3] = {posCN, posSN, posTD}, len[3] = {2, 4, 4};
+    rxq_read_spans_from(chan, framer[chan].hdr, span);
+    for (int f=0; f<3; f++) {
+        for (int i=0; i<len[f]; i++) {
+            field[f] = field[f] << 8 | frameByte(span, from[f] + i);
+        }
+    }
+    return dedup_seen((uint16_t)field[0], field[1], field[2], timebase_ms());
+}
+
+// A valid punch to go in the compact format: its record over its first chars, returns the
+// chars saved
+static int encodePunch(int chan) {
+    ring_span_t span[2];
+    uint8_t p[WIRE_PUNCH_MAX];
+    size_t from = framer[chan].hdr - framer[chan].stxetx, len = framer[chan].cursor - from;
+    if (len > sizeof(p)) {
+        return 0;
+    }
+    rxq_read_spans_from(chan, from, span);
+    for (size_t i=0; i<len; i++) {
+        p[i] = frameByte(span, i);
+    }
+    size_t n = wire_encode(chan, p, len);
+    if (n == len) {                                 // In full
+        return 0;
+    }
+    for (size_t i=0; i<n; i++) {
+        *(i < span[0].len ? &span[0].data[i] : &span[1].data[i - span[0].len]) = p[i];
+    }
+    return (int)(len - n);
+}
+
+// A punch failed: the frame ends before the next STX or header after its header,
+// or with the chars taken when there is none
+static void resync(int chan) {
+    ring_span_t span[2];
+    size_t from = framer[chan].hdr + 1, n = framer[chan].cursor - from, i;
+    rxq_read_spans_from(chan, from, span);
+    for (i=0; i<n; i++) {
+        uint8_t c = frameByte(span, i);
+        if (c == STX || c == punchHdr) {
+            break;
+        }
+    }
+    framer[chan].cursor = from + i;
+    framer[chan].stats.rejected++;
+    framer[chan].state = stateReady;
+}
+
+// One state of the FSM; the header search takes up to scanLimit chars.
+// Adds the chars taken to *consumed, returns false when stuck (no chars or no room).
+static bool advance(int chan, size_t scanLimit, size_t *consumed) {
+    ring_span_t span[2];
+    bool found;
+    size_t n;
+    switch (framer[chan].state) {
+        case stateHeader:   // Looking for the header byte
+            if (scanLimit > (size_t)(FRAME_MAX - framer[chan].txLength)) {
+                scanLimit = FRAME_MAX - framer[chan].txLength;
+            }
+            n = scanHeader(chan, scanLimit, &found);
+            framer[chan].txLength += n;
+            if (framer[chan].txLength >= FRAME_MAX) {               // Frame filled (error!)?
+                framer[chan].state = stateReady;                    // Yes! Send as is
+            } else if (found) {                                     // Detected header?
+                framer[chan].hdr = framer[chan].cursor - 1;
+                framer[chan].state = stateLength;                   // Yes! Get length
+            }
+            *consumed += n;
+            return n > 0;
+        case stateLength:   // Reading payload length
+            if (unseen(chan, span) == 0) {
+                return false;
+            }
+            uint8_t c = span[0].data[0];
+            framer[chan].cursor++;
+            framer[chan].last = c;
+            framer[chan].txLength++;
+            if (framer[chan].txLength + c + 2 >= FRAME_MAX) {       // Frame filled?
+                size_t punchStart = framer[chan].hdr - framer[chan].stxetx;
+                if (punchStart > framer[chan].start) {              // Yes! Send the chars before
+                    framer[chan].cursor = punchStart;               // the punch, it goes next
+                    framer[chan].state = stateReady;
+                } else {
+                    resync(chan);                                   // Too long for a punch
+                }
+            } else {
+                framer[chan].stats.punches += c == punchLen;
+                framer[chan].length = c;
+                startPunch(chan, c);
+                // Set punch length, adding 2 CRC bytes and optional ETX delimiter
+                framer[chan].txLength = c + 2 + framer[chan].stxetx;
+                framer[chan].state = statePayload;
+            }
+            *consumed += 1;
+            return true;
+        case statePayload:  // Taking the payload
+            n = unseen(chan, span);                                 // As much of the rest as available
+            if (n > (size_t)framer[chan].txLength) {
+                n = framer[chan].txLength;
+            }
+            takePayload(chan, span, n);
+            framer[chan].cursor += n;
+            framer[chan].txLength -= n;
+            if (framer[chan].txLength == 0) {                       // Last char taken?
+                if (punchValid(chan)) {                             // Yes! Check CRC and ETX
+                    framer[chan].stats.valid++;
+                    bool punch = framer[chan].length == punchLen;   // Other frames as they are
+                    if (punch && seenBefore(chan)) {
+                        framer[chan].stats.duplicates++;
+                        framer[chan].dropTail = framer[chan].cursor - framer[chan].hdr + framer[chan].stxetx;
+                    } else if (punch && wire_on()) {
+                        framer[chan].dropTail = encodePunch(chan);
+                    }
+                    framer[chan].state = stateReady;
+                } else {
+                    resync(chan);
+                }
+            }
+            *consumed += n;
+            return n > 0;
+        case stateReady:    // A complete punch: publish it and look for the next one
+            if (framer[chan].dropTail > 0) {                        // The chars before the tail only
+                size_t sendEnd = framer[chan].cursor - framer[chan].dropTail;
+                if (sendEnd > framer[chan].start) {
+                    if (!frameq_commit(chan, sendEnd - framer[chan].start, timebase_us())) {
+                        return false;
+                    }
+                    framer[chan].start = sendEnd;
+                }
+                if (!frameq_drop(chan, framer[chan].cursor - framer[chan].start)) {
+                    return false;
+                }
+                framer[chan].dropTail = 0;
+            } else if (!frameq_commit(chan, framer[chan].cursor - framer[chan].start, timebase_us())) {
+                return false;                                       // Frame queue full, later
+            }
+            framer[chan].start = framer[chan].cursor;
+            framer[chan].txLength = 0;
+            framer[chan].last = 0;
+            framer[chan].state = stateHeader;
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t framer_run(int chan) {
+    ring_span_t span[2];
+    size_t consumed = 0, avail = unseen(chan, span);
+    if (avail > RX_QUEUE_SIZE) {
+        skipLost(chan, avail);
+    }
+    while (advance(chan, FRAME_MAX, &consumed)) {
+    }
+    return consumed;
+}
+
+bool framer_step(int chan) {
+    ring_span_t span[2];
+    size_t consumed = 0, avail = unseen(chan, span);
+    if (avail > RX_QUEUE_SIZE) {
+        skipLost(chan, avail);
+    }
+    return advance(chan, 1, &consumed);
+}
+
+void framer_stats(int chan, framer_stats_t *stats) {
+    *stats = framer[chan].stats;
+}
+
+bool framer_punch_time(const ring_span_t data[2], size_t len, uint32_t *time) {
+    size_t hdr = 0;
+    while (hdr < len && frameByte(data, hdr) != punchHdr) {    // The first header ends the search
+        hdr++;
+    }
+    if (hdr + posTSS >= len || frameByte(data, hdr + 1) != punchLen) {
+        return false;
+    }
+    uint8_t td = frameByte(data, hdr + posTD);
+    uint32_t halfDays = (((td >> 4) & 3) * 7 + ((td >> 1) & 7)) * 2 + (td & 1);
+    uint32_t seconds = frameByte(data, hdr + posTH) << 8 | frameByte(data, hdr + posTL);
+    *time = ((halfDays * 43200 + seconds) * 256 + frameByte(data, hdr + posTSS)) % PUNCH_TIME_CYCLE;
+    return true;
+}
+
+int32_t framer_punch_time_diff(uint32_t a, uint32_t b) {
+    int32_t d = (int32_t)(a - b);
+    if (d > (int32_t)(PUNCH_TIME_CYCLE / 2)) {
+        d -= PUNCH_TIME_CYCLE;
+    } else if (d < -(int32_t)(PUNCH_TIME_CYCLE / 2)) {
+        d += PUNCH_TIME_CYCLE;
+    }
+    return d;
+}
@@ -0,0 +1,58 @@
+#ifndef FRAMER_H
+#define FRAMER_H
+
+// Punch framing: splits each channel's received byte stream (rx queue) into frames for
+// transmission (frame queue). The bytes stay in the rx queue, the frame queue gets
+// descriptors of them. Every byte is relayed; a frame runs up to and including a
+// punch header, then the length byte, the payload, two CRC bytes and the ETX when the
+// header followed an STX. Bytes that are not a punch go out in frames of at most FRAME_MAX.
+// A punch is checked by its CRC (sicrc.h) and ETX as it comes in. One that fails (a bit
+// error, a lost or extra char, or a header byte in other data) ends at the next STX or
+// header after its header, where the search starts again, so a bad length byte does not
+// take the following punches along; its bytes are relayed all the same.
+// A valid punch seen within DEDUP_WINDOW_MS, on any channel, is dropped (dedup.h); the
+// other bytes of its frame still go. With the compact radio format (wire.h) a valid punch
+// may go as a record, written over its first chars in the rx queue; the rest is dropped.
+// Runs on core1: a reader of the rx queues ahead of their consumer, the transmitter, and
+// the producer of the frame queues.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame everything buffered for a channel: scans for headers a span at a time and commits
+// every complete frame. Returns the bytes consumed, 0 when nothing could be done.
+size_t framer_run(int chan);
+
+// A single step of the framing state machine, header search one byte at a time
+// (the framing of earlier versions, kept for comparison). True if it made progress.
+bool framer_step(int chan);
+
+// Counts of a channel since start up
+typedef struct {
+    uint32_t punches;       // headers followed by the punch length
+    uint32_t valid;         // frames with a header whose CRC (and ETX) checked
+    uint32_t rejected;      // frames with a header that failed, resynchronised
+    uint32_t duplicates;    // valid punches dropped, seen before
+} framer_stats_t;
+
+void framer_stats(int chan, framer_stats_t *stats);
+
+// Punch time of a frame (its bytes in one or two spans): the TD, TH, TL and TSS fields as
+// 1/256 s in the four week cycle of the week counter, PUNCH_TIME_CYCLE. False if the frame
+// is not a punch.
+#define PUNCH_TIME_CYCLE (4u * 7 * 2 * 43200 * 256)
+bool framer_punch_time(const ring_span_t data[2], size_t len, uint32_t *time);
+int32_t framer_punch_time_diff(uint32_t a, uint32_t b);     // a - b, across the cycle end
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
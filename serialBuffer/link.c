@@ -0,0 +1,127 @@
+// Radio link telemetry: drain rate and queue overflow forecast
+
+#include <string.h>
+#include "link.h"
+#include "cts.h"
+#include "txeng.h"
+#include "frameq.h"
+#include "flashlog.h"
+
+static struct {
+    uint32_t sampleUs;          // start of the sample
+    uint32_t sent;              // engine bytes then
+    uint32_t in[Nchannels];     // rx queue bytes enqueued then
+    uint32_t count[Nchannels];  // and waiting
+    uint32_t frames[Nchannels]; // frames waiting then
+    bool waiting;               // frames waiting then
+    uint32_t holds;             // CTS holds seen
+    uint32_t windowSent;        // engine bytes when the clear window began
+    bool sampled;               // a sample taken: the means start from it
+} last;
+static link_stats_t counts;
+
+static uint32_t sentBytes(void) {
+    txeng_stats_t st;
+    txeng_stats(&st);
+    return st.bytes;
+}
+
+static bool framesWaiting(void) {
+    for (int chan=0; chan<Nchannels; chan++) {
+        if (frameq_count(chan) > 0) {
+            return true;
+        }
+    }
+    return !txeng_idle() || flashlog_pages() > 0;   // Or spilled to flash
+}
+
+// Moving mean, at least a unit a sample so that it reaches x
+static int32_t mean(int32_t m, int32_t x, bool first) {
+    int32_t step = (x - m) / LINK_MEAN_WEIGHT;
+    return first ? x : m + (step != 0 ? step : (x > m) - (x < m));
+}
+
+void link_init(uint32_t nowUs) {
+    memset(&counts, 0, sizeof(counts));
+    memset(&last, 0, sizeof(last));
+    cts_stats_t cts;
+    cts_stats(&cts);
+    last.sampleUs = nowUs;
+    last.sent = last.windowSent = sentBytes();
+    last.holds = cts.holds + cts_held();
+    last.waiting = framesWaiting();
+    for (int chan=0; chan<Nchannels; chan++) {
+        ring_stats_t rx;
+        rxq_stats(chan, &rx);
+        last.in[chan] = rx.enqueued;
+        last.count[chan] = rxq_count(chan);
+        last.frames[chan] = frameq_count(chan);
+    }
+    counts.fullChan = -1;
+}
+
+// Seconds until free is used up growing by grow per period seconds, UINT32_MAX if it does not grow
+static uint32_t fullIn(uint32_t free, int32_t grow, uint32_t period) {
+    return grow > 0 ? (uint32_t)((uint64_t)free * period / (uint32_t)grow) : UINT32_MAX;
+}
+
+// A CTS hold began: the clear window before it is over
+static void watchWindows(void) {
+    cts_stats_t cts;
+    cts_stats(&cts);
+    uint32_t holds = cts.holds + cts_held();        // ended and going on
+    if (holds != last.holds) {
+        uint32_t sent = sentBytes(), bytes = sent - last.windowSent;
+        counts.windowBytes = mean(counts.windowBytes, bytes, counts.windows == 0);
+        counts.maxWindowBytes = bytes > counts.maxWindowBytes ? bytes : counts.maxWindowBytes;
+        counts.windows++;
+        last.windowSent = sent;
+        last.holds = holds;
+    }
+}
+
+bool link_poll(uint32_t nowUs) {
+    watchWindows();
+    uint32_t elapsed = nowUs - last.sampleUs;
+    if (elapsed < LINK_SAMPLE_MS * 1000u) {
+        return false;
+    }
+    bool first = !last.sampled, waiting = framesWaiting();
+    uint32_t sent = sentBytes(), inBytes = 0;
+    int32_t sentBps = (int32_t)((uint64_t)(sent - last.sent) * 1000000 / elapsed);
+    counts.sentBps = mean(counts.sentBps, sentBps, first);
+    if (waiting && last.waiting) {                  // Loaded: what the link takes
+        counts.drainBps = mean(counts.drainBps, sentBps, counts.drainBps == 0);
+    }
+    counts.fullChan = -1;
+    for (int chan=0; chan<Nchannels; chan++) {
+        ring_stats_t rx;
+        rxq_stats(chan, &rx);
+        uint32_t count = rxq_count(chan), frames = frameq_count(chan);
+        inBytes += rx.enqueued - last.in[chan];
+        int32_t grow = (int32_t)(((int64_t)count - last.count[chan]) * 1000000 / elapsed);
+        counts.growBps[chan] = mean(counts.growBps[chan], grow, first);
+        grow = (int32_t)(((int64_t)frames - last.frames[chan]) * 60000000 / elapsed);
+        counts.growFpm[chan] = mean(counts.growFpm[chan], grow, first);
+        uint32_t bytesFull = fullIn(RX_QUEUE_SIZE - count, counts.growBps[chan], 1);
+        uint32_t framesFull = fullIn(FRAME_QUEUE_SIZE - frames, counts.growFpm[chan], 60);
+        uint32_t full = bytesFull < framesFull ? bytesFull : framesFull;
+        if (full != UINT32_MAX && (counts.fullChan < 0 || full < counts.fullInS)) {
+            counts.fullChan = chan;
+            counts.fullInS = full;
+        }
+        last.in[chan] = rx.enqueued;
+        last.count[chan] = count;
+        last.frames[chan] = frames;
+    }
+    counts.inBps = mean(counts.inBps, (int32_t)((uint64_t)inBytes * 1000000 / elapsed), first);
+    last.sampleUs = nowUs;
+    last.sent = sent;
+    last.waiting = waiting;
+    last.sampled = true;
+    return true;
+}
+
+void link_stats(link_stats_t *stats) {
+    *stats = counts;
+}
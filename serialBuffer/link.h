@@ -0,0 +1,46 @@
+#ifndef LINK_H
+#define LINK_H
+
+// Radio link telemetry: how fast the TinyMesh link actually drains, and when a channel's
+// queues overflow at the present rates. From the CTS holds (cts.h) and the bytes the transmit
+// engine handed to the UART: the bytes taken per CTS clear window, counted at frame ends.
+// Every LINK_SAMPLE_MS the rates in and out are sampled into running means weighted
+// 1/LINK_MEAN_WEIGHT to the latest: the bytes/s sent, the same over samples with frames
+// waiting throughout, what the link takes when loaded, and per channel how fast its rx queue
+// (bytes) and frame queue (frames) grow. A growing channel is full when the first of the two
+// is, its free space over its growth; with punches, the frame queue.
+// Hardware independent; runs in the main loop on core0.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LINK_SAMPLE_MS 1000
+#define LINK_MEAN_WEIGHT 4
+
+typedef struct {
+    uint32_t windows;           // CTS clear windows, ended by a hold
+    uint32_t windowBytes;       // bytes taken in one, running mean
+    uint32_t maxWindowBytes;
+    uint32_t sentBps;           // bytes/s to the radio
+    uint32_t drainBps;          // bytes/s to the radio with frames waiting, 0 before such a sample
+    uint32_t inBps;             // bytes/s received, all channels
+    int32_t growBps[Nchannels]; // bytes/s each rx queue grows by
+    int32_t growFpm[Nchannels]; // frames/min each frame queue grows by
+    int fullChan;               // the channel whose queues fill first, -1 if none grows
+    uint32_t fullInS;           // in how many seconds
+} link_stats_t;
+
+void link_init(uint32_t nowUs);
+bool link_poll(uint32_t nowUs);         // every pass; true when it took a sample
+void link_stats(link_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
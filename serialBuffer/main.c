@@ -1,16 +1,23 @@
 /**
  * Copyright (c) 2022 FIF orientering.
  * 
- * Serial buffer, dual channel version
- * Buffers serial data from UART0 and UART1, to facilitate interfacing a transmitter without flow control
- * to a slow receiver with flow control.
+ * Serial buffer, multi channel version
+ * Buffers serial data from UART0 and UART1, and from PIO UART receivers for more SRRs (Nchannels), to
+ * facilitate interfacing a transmitter without flow control to a slow receiver with flow control.
  * All characters are relayed as received.
  * The CTS input from the radio module is respected, stopping the Tx until released
  * No flow control toward the SRRs 
- * Simple polled loop, continuously receiving bytes, sending complete contiguous punches
- * Interleaving punches from N stations. 
+ * Core1 serves the SRRs: bytes are received by UART interrupts (or DMA, see RX_DMA) and a polled loop
+ * assembles complete contiguous punches into the frame queues.
+ * Core0 serves the radio: it takes the punches from the frame queues and hands them to the radio UART
+ * by DMA, a whole punch at a time, interleaving punches from N stations, and reports status.
+ * Frames beyond what the queues hold while the radio lags go to a log in flash and are sent from
+ * there later, in order (spill.h), with RX_DMA: both cores wait while the flash erases or programs,
+ * and the DMA receives on.
+ * Both cores sleep while they have nothing to do (SLEEP_IDLE); a UART or DMA interrupt, or the other
+ * core's event, wakes them.
  * The LED shows a second of fast blinking on program start
- * Then turns on when receiving, off when sending chars, so it blinks on every punch.
+ * Then is on while a punch is being sent, so it blinks on every punch.
  */
 
 /// \tag::SerialBuffer[]
@@ -19,91 +26,364 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "pico/time.h"
+#include "pico/stdio_usb.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
 #include "hardware/gpio.h"
 #include "hardware/uart.h"
-#include "fifo.h"
+#include "hardware/irq.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "config.h"
+#include "ring.h"
+#include "frameq.h"
+#include "stats.h"
+#include "timebase.h"
+#include "uartrx.h"
+#include "dmarx.h"
+#include "txeng.h"
+#include "framer.h"
+#include "arbiter.h"
+#include "autobaud.h"
+#include "dedup.h"
+#include "wire.h"
+#include "pack.h"
+#include "cts.h"
+#include "link.h"
+#include "spill.h"
+#include "uart_rx.pio.h"
 
 #define blinkRate 200           // Initial blink rate [mS]
 #define blinkDuty 0.2           // initial blink duty cycle (ON fraction) 
-#define Nchannels 2 
 
-#define BAUD_RATE 38400
 #define DATA_BITS 8
 #define STOP_BITS 1
 #define PARITY    UART_PARITY_NONE
+#define RX_FIFO_LEVEL 2         // RX interrupt at 1/2 full FIFO (16 chars), the rest by RX timeout
 
-#define RX_QUEUE_SIZE 10*1024   // Queue for received punches as stream bytes
-#define TX_QUEUE_SIZE 128       // Queue for tx-ready punches, one at a time (oversized))
-
-long loopCount = 0;
-uint8_t rx_char, tx_char;
+long loopCount = 0;             // Core0 loop passes
+long rxLoopCount = 0;           // Core1 loop passes
+frame_t txFrame;                // Frame last handed to the transmit engine
+uint32_t statsTime = 0;         // Last status report [ms]
+stats_t stats;
 const uint LED_PIN = PICO_DEFAULT_LED_PIN;
-// Definitions of the punch format
-// Documentation: PC programmer's guide and SISRR1AP serial data record
-// Each punch is a sequence of 17 to 18 chars
-// Starting with an (optional) constant preamble byte, a constant header byte 
-// and a length byte (always 13), then "length" payload bytes and two CRC bytes.
-// We transfer all chars, but use the header and length to assemble complete punches for tx
-// The length byte is respected to allow for future formats
-// We attempt to transfer all data, even when the above format is not maintained.
-const uint8_t STX 	= 0x02; 	// STX, constant preamble of punch (only in "new" format?)
-const uint8_t ETX 	= 0x03; 	// STX, constant preamble of punch (only in "new" format?)
-const uint8_t punchHdr 	= 0xD3; 	// 211, Constant first byte of every punch
-
-// States of the punch assembly and tx process:
-// Look for a header, get the payload length, move the payload, transmit a punch
-enum states {stateHeader, stateLength, statePayload, stateReady, stateTransmit};
-
-// Define the channels
+
+// Define the channels: the two UARTs, then PIO state machines running uart_rx.pio, one row each.
+// Channel 0's UART also carries the radio link (TX, CTS) at RADIO_BAUD. An SRR on channel 0 at
+// another rate is received by the spare state machine of the last row instead.
+enum rxKind {rxUart, rxPio};
+
 struct channelType {
-    uart_inst_t *uart_id;
+    enum rxKind rxKind;
+    uint baud;                  // input rate, or AUTOBAUD
+    uart_inst_t *uart_id;       // rxUart
     int txGPIO;
     int rxGPIO;
     int ctsGPIO;
     int rtsGPIO;
     bool ctsEn;
     bool rtsEn;
-    int chars_rxed;
-    int chars_txed;    
-    queue_t *rxQueue;    // Buffer for received data as chars
-    queue_t *txQueue;   // buffer for one complete, ready to tx, punch
-    int  state;
-    int txLength;       // count of chars in current punch
-    int stxetx;         // STX/ETX delimiters used in punch
-    uint8_t im_char;    // Intermediate char for rx to tx
-    uint8_t prev_im_char;
+    PIO pio;                    // rxPio
+    uint sm;
+    int chars_txed;
 };
 
-struct channelType channel[Nchannels] = {
-    [0].uart_id      = uart0,
-    [1].uart_id      = uart1,
-    [0].txGPIO   = 0,   // pin 1
-    [1].txGPIO   = 4,   // pin 6
-    [0].rxGPIO   = 1,   // pin 2
-    [1].rxGPIO   = 5,   // pin 7
-    [0].ctsGPIO  = 2,   // pin 4
-    [1].ctsGPIO  = 6,   // pin 9
-    [0].ctsEn   = true,
-    [1].ctsEn   = true,
-    [0].rtsEn   = false,
-    [1].rtsEn   = false,
-    [0].chars_rxed = 0,
-    [1].chars_txed = 0,
-    [0].chars_rxed = 0,
-    [1].chars_txed = 0,
-    [0].state = stateHeader,
-    [1].state = stateHeader,
-    [0].txLength = 0,
-    [1].txLength = 0,
-    [0].stxetx = 0,
-    [1].stxetx = 0,
-    [0].im_char = 0,
-    [1].im_char = 0,
-    [0].prev_im_char = 0,
-    [1].prev_im_char = 0
+#define PIO_CHANNEL(gpio, block, machine) {.rxKind = rxPio, .baud = 38400, .rxGPIO = gpio, .pio = block, .sm = machine}
+
+struct channelType channel[] = {
+    {.rxKind = rxUart, .baud = 38400, .uart_id = uart0, .txGPIO = 0, .rxGPIO = 1, .ctsGPIO = 2, .ctsEn = true},  // pins 1, 2, 4
+    {.rxKind = rxUart, .baud = 38400, .uart_id = uart1, .txGPIO = 4, .rxGPIO = 5, .ctsGPIO = 6, .ctsEn = true},  // pins 6, 7, 9
+    PIO_CHANNEL(7, pio0, 0),    // pin 10
+    PIO_CHANNEL(8, pio0, 1),    // pin 11
+    PIO_CHANNEL(9, pio0, 2),    // pin 12
+    PIO_CHANNEL(10, pio0, 3),   // pin 14
+    PIO_CHANNEL(11, pio1, 0),   // pin 15
+    PIO_CHANNEL(12, pio1, 1),   // pin 16
+    PIO_CHANNEL(13, pio1, 2),   // pin 17
+    PIO_CHANNEL(14, pio1, 3),   // pin 19
 };
+_Static_assert(Nchannels <= sizeof(channel) / sizeof(channel[0]), "a channel row per input");
+
+// Line errors of a PIO receiver since the last call: a low stop bit sets IRQ flag 4 + sm,
+// a full RX FIFO stalls the state machine (characters lost)
+static uint32_t pioLineErrors(int chan) {
+    PIO pio = channel[chan].pio;
+    uint32_t errors = 0;
+    uint32_t stopLow = 1u << (4 + channel[chan].sm);
+    uint32_t stall = 1u << (PIO_FDEBUG_RXSTALL_LSB + channel[chan].sm);
+    if (pio->irq & stopLow) {
+        pio->irq = stopLow;                         // Write clears
+        errors |= UARTRX_FE;
+    }
+    if (pio->fdebug & stall) {
+        pio->fdebug = stall;
+        errors |= UARTRX_OE;
+    }
+    return errors;
+}
+
+// Start a PIO receiver, loading the program into its PIO block the first time
+static void initPioRx(int chan, uint baud) {
+    static uint offset[NUM_PIOS];
+    static uint loaded;
+    PIO pio = channel[chan].pio;
+    uint block = pio_get_index(pio);
+    if (!(loaded & (1u << block))) {
+        offset[block] = pio_add_program(pio, &uart_rx_program);
+        loaded |= 1u << block;
+    }
+    uart_rx_program_init(pio, channel[chan].sm, offset[block], channel[chan].rxGPIO, baud);
+}
+
+// Channel 0's SRR off UART0, which then only sends to the radio
+static void moveChannel0ToPio(void) {
+    const struct channelType *spare = &channel[sizeof(channel) / sizeof(channel[0]) - 1];
+    if (Nchannels == sizeof(channel) / sizeof(channel[0])) {
+        panic("No PIO state machine left for channel 0 at a rate other than RADIO_BAUD");
+    }
+    channel[0].rxKind = rxPio;
+    channel[0].pio = spare->pio;
+    channel[0].sm = spare->sm;
+}
+
+// Set an input's receiver to a new rate (autobaud)
+static void setBaud(int chan, uint baud) {
+    if (channel[chan].rxKind == rxPio) {
+        pio_sm_set_clkdiv(channel[chan].pio, channel[chan].sm, (float)clock_get_hz(clk_sys) / (8 * baud));
+    } else {
+        uart_set_baudrate(channel[chan].uart_id, baud);
+    }
+}
+
+// Detect the rate of an input set to AUTOBAUD from its reception counters
+static void pollAutobaud(int chan) {
+    uartrx_stats_t rx;
+    framer_stats_t fr;
+#if RX_DMA
+    dmarx_stats(chan, &rx);
+#else
+    uartrx_stats(chan, &rx);
+#endif
+    framer_stats(chan, &fr);
+    uint32_t baud = autobaud_poll(chan, rx.bytes, rx.framingErrors + rx.breaks, fr.valid);
+    if (baud) {
+        setBaud(chan, baud);
+    }
+}
+
+#if !RX_DMA
+// UART access for the interrupt driven reception (uartrx.c)
+static bool uartReadable(int chan) {
+    if (channel[chan].rxKind == rxPio) {
+        return !pio_sm_is_rx_fifo_empty(channel[chan].pio, channel[chan].sm);
+    }
+    return uart_is_readable(channel[chan].uart_id);
+}
+
+static uint32_t uartRead(int chan) {
+    if (channel[chan].rxKind == rxPio) {            // The character, errors seen since the last one
+        return pio_sm_get(channel[chan].pio, channel[chan].sm) >> 24 | pioLineErrors(chan);
+    }
+    return uart_get_hw(channel[chan].uart_id)->dr;  // Character with its error flags
+}
+
+static const uartrx_port_t uartPort = {uartReadable, uartRead};
+static int uartChannel[2];                          // Channel served by UART0 and UART1
+
+// RX FIFO level and RX timeout interrupt, shared by both UARTs
+static void onUartRx(void) {
+    uint irq = __get_current_exception() - VTABLE_FIRST_IRQ;
+    uartrx_irq(uartChannel[irq - UART0_IRQ]);
+}
+
+// RX FIFO not empty interrupt of a PIO block, shared by its state machines
+static void onPioRx(void) {
+    uint block = (__get_current_exception() - VTABLE_FIRST_IRQ - PIO0_IRQ_0) / 2;
+    for (int chan=0; chan<Nchannels; chan++) {
+        if (channel[chan].rxKind == rxPio && pio_get_index(channel[chan].pio) == block && uartReadable(chan)) {
+            uartrx_irq(chan);
+        }
+    }
+}
+
+#else
+// DMA access for the DMA driven reception (dmarx.c)
+static uint rxDma[Nchannels];                       // DMA channel of each channel's UART
+
+static uint32_t dmaTransferCount(int chan) {
+    return dma_channel_hw_addr(rxDma[chan])->transfer_count;
+}
+
+static uint32_t uartLineErrors(int chan) {
+    if (channel[chan].rxKind == rxPio) {
+        return pioLineErrors(chan);
+    }
+    uart_hw_t *hw = uart_get_hw(channel[chan].uart_id);
+    uint32_t rsr = hw->rsr & UART_UARTRSR_BITS;     // FE, PE, BE, OE as in the data register
+    hw->rsr = 0;                                    // Write clears
+    return rsr << 8;
+}
+
+static const dmarx_port_t dmaPort = {dmaTransferCount, uartLineErrors};
+
+// Let a DMA channel copy the UART's received characters into the channel's rx queue storage
+static void startRxDma(int chan) {
+    _Static_assert(RX_QUEUE_SIZE <= 32*1024, "DMA ring mode wraps at most 2^15 bytes");
+    struct channelType *ch = &channel[chan];
+    rxDma[chan] = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(rxDma[chan]);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);                   // Data register
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, __builtin_ctz(RX_QUEUE_SIZE)); // Wrap writes at the queue end
+    if (ch->rxKind == rxPio) {                                      // The character byte of the FIFO word
+        channel_config_set_dreq(&c, pio_get_dreq(ch->pio, ch->sm, false));
+        dma_channel_configure(rxDma[chan], &c, rxq_storage(chan), (io_rw_8 *)&ch->pio->rxf[ch->sm] + 3,
+                              DMARX_COUNT, true);
+    } else {
+        channel_config_set_dreq(&c, uart_get_dreq(ch->uart_id, false)); // One transfer per received char
+        dma_channel_configure(rxDma[chan], &c, rxq_storage(chan), &uart_get_hw(ch->uart_id)->dr,
+                              DMARX_COUNT, true);
+    }
+}
+#endif
+
+// DMA access for the transmit engine (txeng.c): frames to the radio UART, paced by its TX DREQ
+static uint txDma;
+
+static void txDmaStart(const uint8_t *data, size_t len) {
+    dma_channel_transfer_from_buffer_now(txDma, data, len);
+}
+
+static const txeng_port_t txPort = {txDmaStart};
+
+static void onTxDmaDone(void) {
+    dma_channel_acknowledge_irq0(txDma);
+    txeng_irq();
+}
+
+// The radio's CTS changed: nCTS, low is clear
+static void onCts(uint gpio, uint32_t events) {
+    (void)events;
+    cts_edge(!gpio_get(gpio), timebase_us());
+}
+
+// Flash access for the spill log (flashlog.c), the last SPILL_LOG_KB of the flash. The program
+// runs from the flash, so nothing may run from it while it erases or programs: core1 is
+// locked out (it waits in RAM, its interrupts off) and core0 runs the SDK's flash_range_
+// functions, in RAM, with its interrupts off, until the flash is done. The loop so stalls
+// for an erase (45 ms, at worst 400 ms); the rx DMA goes on receiving meanwhile, which is why
+// the log needs RX_DMA. Interrupts that came meanwhile are taken after.
+#define SPILL_LOG_OFFSET (PICO_FLASH_SIZE_BYTES - SPILL_LOG_KB * 1024u)
+_Static_assert(SPILL_LOG_KB * 1024u % FLASHLOG_SECTOR == 0, "the log is whole sectors");
+
+static void flashErase(uint32_t offset) {
+    multicore_lockout_start_blocking();
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_erase(SPILL_LOG_OFFSET + offset, FLASHLOG_SECTOR);
+    restore_interrupts(ints);
+    multicore_lockout_end_blocking();
+}
+
+static void flashProgram(uint32_t offset, const uint8_t *page) {
+    multicore_lockout_start_blocking();
+    uint32_t ints = save_and_disable_interrupts();
+    flash_range_program(SPILL_LOG_OFFSET + offset, page, FLASHLOG_PAGE);
+    restore_interrupts(ints);
+    multicore_lockout_end_blocking();
+}
+
+static bool flashBusy(void) {
+    return false;                                   // Done before erase or program returns
+}
+
+static void flashRead(uint32_t offset, uint8_t *data, size_t len) {
+    memcpy(data, (const uint8_t *)XIP_NOCACHE_NOALLOC_BASE + SPILL_LOG_OFFSET + offset, len);
+}
+
+static const flashlog_port_t flashPort = {flashErase, flashProgram, flashBusy, flashRead};
+
+static void startTxDma(uart_inst_t *uart) {
+    txDma = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(txDma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);                  // Data register
+    channel_config_set_dreq(&c, uart_get_dreq(uart, true));         // One transfer per free TX FIFO slot
+    dma_channel_configure(txDma, &c, &uart_get_hw(uart)->dr, NULL, 0, false);
+    dma_channel_set_irq0_enabled(txDma, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, onTxDmaDone);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+// Start receiving a channel, on the core that is to run its reception
+static void startRx(int chan) {
+#if RX_DMA
+    // Receive by DMA into the rx queue storage, published by dmarx_poll in the loop
+    startRxDma(chan);
+#else
+    // Receive by interrupt: the handler drains the whole FIFO into the rx queue
+    if (channel[chan].rxKind == rxPio) {
+        PIO pio = channel[chan].pio;
+        uint irq = PIO0_IRQ_0 + 2 * pio_get_index(pio);
+        irq_set_exclusive_handler(irq, onPioRx);
+        pio_set_irq0_source_enabled(pio, pis_sm0_rx_fifo_not_empty + channel[chan].sm, true);
+        irq_set_enabled(irq, true);
+        return;
+    }
+    uart_inst_t *uart = channel[chan].uart_id;
+    uint irq = UART0_IRQ + uart_get_index(uart);
+    uartChannel[uart_get_index(uart)] = chan;
+    irq_set_exclusive_handler(irq, onUartRx);
+    uart_set_irq_enables(uart, true, false);       // RX and RX timeout
+    hw_write_masked(&uart_get_hw(uart)->ifls,
+                    RX_FIFO_LEVEL << UART_UARTIFLS_RXIFLSEL_LSB, UART_UARTIFLS_RXIFLSEL_BITS);
+    irq_set_enabled(irq, true);
+#endif
+}
+
+// Core1: the SRR side. Receives the UARTs (interrupts enabled here are taken by this core)
+// and frames the punches into the frame queues, which core0 empties: each is a single
+// producer / single consumer queue, so the cores need no lock.
+// Sleeping uses WFE, not WFI: an interrupt or event that comes between the last look at the
+// queues and the sleep leaves the event flag set, so the WFE returns at once.
+static void core1Main(void) {
+    multicore_lockout_victim_init();                // Held in RAM while core0 writes the flash
+    for (int chan=0; chan<Nchannels; chan++  ){
+        startRx(chan);
+    }
+    while (1) {
+        rxLoopCount ++;
+        size_t framed = 0;
+        for (int chan=0; chan<Nchannels; chan++  ){  // through channels
+#if RX_DMA
+            dmarx_poll(chan);                       // Publish what the DMA received
+#endif
+            framed += framer_run(chan);             // Every complete punch to the frame queue
+            if (!autobaud_locked(chan)) {
+                pollAutobaud(chan);                 // Still finding the rate
+            }
+        }
+        if (framed > 0) {
+            __sev();                                // Wake core0 for the frames
+        }
+#if SLEEP_IDLE
+        else {
+#if RX_DMA
+            best_effort_wfe_or_timeout(make_timeout_time_us(RX_DMA_POLL_US));
+#else
+            __wfe();                                // Until a UART interrupt, or core0 made room
+#endif
+        }
+#endif
+    }
+}
 
 int main() {
+    // Status reports go to USB serial, the UARTs belong to the SRRs and the radio
+    stdio_init_all();
     // Visual indication of running program
     printf ("Started Serial Buffer\n");
     gpio_init(LED_PIN);
@@ -116,29 +396,35 @@ int main() {
     }
 
     // Initialisation
-    queue_t rxQueue[Nchannels] = {
-        {0, 0, RX_QUEUE_SIZE, malloc(sizeof(uint8_t*) * RX_QUEUE_SIZE)},
-        {0, 0, RX_QUEUE_SIZE, malloc(sizeof(uint8_t*) * RX_QUEUE_SIZE)} };
-    queue_t txQueue[Nchannels] = {
-        {0, 0, TX_QUEUE_SIZE, malloc(sizeof(uint8_t*) * TX_QUEUE_SIZE)},
-        {0, 0, TX_QUEUE_SIZE, malloc(sizeof(uint8_t*) * TX_QUEUE_SIZE)} };
-
+#if RX_DMA
+    dmarx_init(&dmaPort);
+#else
+    uartrx_init(&uartPort);
+#endif
+    if (channel[0].baud != RADIO_BAUD) {
+        moveChannel0ToPio();
+    }
     for (int chan=0; chan<Nchannels; chan++  ){  // through channels
-        // Allocate the queue buffers
-        channel[chan].rxQueue = &rxQueue[chan];
-        channel[chan].txQueue = &txQueue[chan];
-
+        autobaud_init(chan, channel[chan].baud);
+        if (channel[chan].rxKind == rxPio) {
+            initPioRx(chan, autobaud_rate(chan));
+        }
+        if (channel[chan].rxKind == rxPio && chan != 0) {
+            continue;
+        }
         // Set up UARTs with a basic baud rate.
         uart_init(channel[chan].uart_id , 2400);
-        // Actually, we want a different speed
+        // Actually, we want a different speed: the SRR's, or the radio's on UART0
         // The call will return the actual baud rate selected, which will be as close as
         // possible to that requested
-        uart_set_baudrate(channel[chan].uart_id  , BAUD_RATE);
+        uart_set_baudrate(channel[chan].uart_id, chan == 0 ? RADIO_BAUD : autobaud_rate(chan));
         // Set the TX and RX pins by using the function select on the GPIO
         // Set datasheet for more information on function select
         gpio_set_function(channel[chan].txGPIO, GPIO_FUNC_UART);
-        gpio_set_function(channel[chan].rxGPIO, GPIO_FUNC_UART);
-        gpio_set_pulls(channel[chan].rxGPIO, true, false);
+        if (channel[chan].rxKind == rxUart) {
+            gpio_set_function(channel[chan].rxGPIO, GPIO_FUNC_UART);
+            gpio_set_pulls(channel[chan].rxGPIO, true, false);
+        }
         gpio_set_function(channel[chan].ctsGPIO , GPIO_FUNC_UART);
 
 
@@ -150,94 +436,64 @@ int main() {
 
         // Turn on FIFO's
         uart_set_fifo_enabled(channel[chan].uart_id, true);
-
     } // initialisation
+    arbiter_init(TX_ARBITER);
+    spill_init(&flashPort, RX_DMA ? SPILL_LOG_KB * 1024u : 0, SPILL_HIGH, SPILL_LOW);  // See the flash port
+    dedup_init(DEDUP_WINDOW_MS);
+    wire_init(WIRE_KEYFRAME);
+    cts_init(true, !gpio_get(channel[0].ctsGPIO), timebase_us());
+    // The UART still reads the pin for its flow control
+    gpio_set_irq_enabled_with_callback(channel[0].ctsGPIO, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, onCts);
+    pack_init(PACKET_MAX, PACKET_FLUSH_MS * 1000u, PACKET_GAP_MS * 1000u, PACKET_ADAPTIVE);
+    txeng_init(&txPort);
+    link_init(timebase_us());
+    startTxDma(channel[0].uart_id);             // The radio is on channel 0's UART, CTS gates it
+    multicore_launch_core1(core1Main);          // Reception and framing
 
-    while (1) {   // eternal poll loop
+    while (1) {   // eternal poll loop, core0
         loopCount ++;
-        for (int chan=0; chan<Nchannels; chan++  ){  // through channels
-            // Polled Rx
-            if (uart_is_readable(channel[chan].uart_id)) {              // Chars received in UART?
-                rx_char = uart_getc(channel[chan].uart_id);             // Yes!, get from UART
-                queue_write(channel[chan].rxQueue, (void*)rx_char);     // Push into rx queue
-                channel[chan].chars_rxed++;
-                gpio_put(LED_PIN, 1);                                   // Turn LED on
-            } //Get chars from uart to rx queue 
-
-            // Main FSM
-            // Switches states to reflect the punch assembly process
-            // while moving data from the rx buffer to the tx buffer.  
-            switch (channel[chan].state) {
-                case stateHeader:   // Looking for the header byte
-                    if (channel[chan].rxQueue->head != channel[chan].rxQueue->tail) {     // chars in rx queue?
-                        channel[chan].prev_im_char = channel[chan].im_char;                                         // Remember for next read
-                        channel[chan].im_char = (uint8_t)queue_read(channel[chan].rxQueue);           // Yes! Pop char from rx queue
-                        queue_write(channel[chan].txQueue, (void*)channel[chan].im_char);             // Push char to tx queue 
-                        channel[chan].txLength++;                                       // count up
-                        if (channel[chan].txLength >= TX_QUEUE_SIZE) {                  // Tx queue filled (error!)?
-                                channel[chan].state = stateTransmit;                    // Yes! Send as is
-                        } else if (channel[chan].im_char == punchHdr) {                               // No! Detected  header?
-                            channel[chan].stxetx = (channel[chan].prev_im_char == STX); // Delimiters used?                                  // STX preceded header?
-                            channel[chan].state = stateLength;                          // yes, Get length 
-                        } 
-                    } // chars in rx queue
-                break;
-                case stateLength:   // Reading payload length
-                    if (channel[chan].rxQueue->head != channel[chan].rxQueue->tail) {   // chars in rx queue
-                        channel[chan].im_char = (uint8_t)queue_read(channel[chan].rxQueue);           // Pop char from rx queue
-                        queue_write(channel[chan].txQueue, (void*)channel[chan].im_char);             // Push char to tx queue 
-                        channel[chan].txLength++; // count up
-                        if (channel[chan].txLength + channel[chan].im_char + 2 >= TX_QUEUE_SIZE) {    // Tx queue filled (tbd error)?
-                            channel[chan].state = stateTransmit;                        // Yes! Send as is
-                        } else {
-                            // Set punch length, adding 2 CRC bytes and optional ETX delimiter)
-                            channel[chan].txLength = (channel[chan].im_char + 2 + channel[chan].stxetx); // Set length
-                            channel[chan].state = statePayload;                           // Start transfer to tx queue
-                        }   // update tx length
-                    }   // rx queue not empty
-                break;
-                case statePayload: // Transferring payload from rx queue to tx queue
-                    if (channel[chan].rxQueue->head != channel[chan].rxQueue->tail) {   // chars in rx queue?
-                        channel[chan].im_char = (uint8_t)queue_read(channel[chan].rxQueue);           // Yes! Pop char from rx queue
-                        queue_write(channel[chan].txQueue, (void*)channel[chan].im_char);             // Push char to tx queue 
-                        channel[chan].txLength--;                                       // count payload down
-                        if (channel[chan].txLength == 0 ) {                             // last char transferred?
-                            channel[chan].state = stateReady;                           // Yes! flag ready to transmit
-                        }  // last char transferred  TBD Tjek for ETX and add it
-                    } // rx queue not empty
-                break;
-                case stateReady:   // Ready to transmit a punch
-                    channel[chan].txLength = 0;                         // Reset punch length
-                    bool anyTx = false;
-                    for (int c=0; c<Nchannels; c++  ){              // through channels
-                        if (channel[c].state == stateTransmit){     // Any channel transmitting?
-                            anyTx = true;                           // Yes! continue waiting
-                        }
-                    }   // thru channels 
-                    if (!anyTx) {
-                        channel[chan].state = stateTransmit;    // No! start transmission 
-                    }   // Any channel transmitting   
-                break;
-                case stateTransmit:   // Transmitting a punch, do not fill tx queue
-                    if (channel[chan].txQueue->head == channel[chan].txQueue->tail){    // Tx queue empty?
-                        channel[chan].state = stateHeader;                              // Yes! Terminate transmit and look for header
-                    } 
-                break;
-                default:
-                break;
-            } // switch channelState
-
-            // // Polled Tx
-            if(channel[chan].state == stateTransmit) {   // in transmit mode?
-                if  (uart_is_writable(channel[0].uart_id) && 
-                    (channel[chan].txQueue->head != channel[chan].txQueue->tail)) { // OK to tx? 
-                    tx_char = (uint8_t)queue_read(channel[chan].txQueue);           // Yes! pop char
-                    uart_putc(channel[0].uart_id, tx_char);                      // write to UART
-                    channel[chan].chars_txed++;                                     // Count tx
-                    gpio_put(LED_PIN, 0);                                           // LED off
-                } // char transmission 
-            } // stateTransmit, transmitting to UART
-        } // thru channels
+        // Tx by DMA, a radio packet of frames at a time, each copied out of the rx queue as it
+        // is picked (pack.h); the completion interrupt starts the next frame
+        bool sent = false;
+        if (spill_poll() > 0) {                                     // Queues filling up: the oldest frames to flash
+            __sev();                                                // Frame queue room for core1
+        }
+        ring_span_t data[2];
+        while (txeng_ready() && pack_next(&txFrame, data)) {        // Room in the engine and a frame due?
+            txeng_submit(&txFrame, data);                           // Yes! send it
+            channel[txFrame.chan].chars_txed += txFrame.len;        // Count tx
+            __sev();                                                // Frame queue room for core1
+            sent = true;
+        }
+        gpio_put(LED_PIN, !txeng_idle());                           // LED on while sending
+
+        // Link telemetry; an rx queue filling up is reported at once, not with the next status
+        if (link_poll(timebase_us()) && stdio_usb_connected()) {
+            link_stats_t link;
+            link_stats(&link);
+            if (link.fullChan >= 0 && link.fullInS < LINK_WARN_S) {
+                printf("overload: ch%d queues full in %lu s, in=%lu B/s link=%lu B/s\n", link.fullChan,
+                       (unsigned long)link.fullInS, (unsigned long)link.inBps, (unsigned long)link.drainBps);
+            }
+        }
+
+        // Status report, only when a USB host listens so the loop never waits for it
+        if (timebase_ms() - statsTime >= STATS_PERIOD_MS) {
+            statsTime = timebase_ms();
+            if (stdio_usb_connected()) {
+                stats_collect(&stats);
+                stats_print(&stats);
+            }
+        }
+#if SLEEP_IDLE
+        if (!sent) {        // Until core1 has frames, a transmission is done, a held punch or a packet is due, the flash or the next report
+            uint32_t sleepUs = (STATS_PERIOD_MS - (timebase_ms() - statsTime)) * 1000u;
+            uint32_t dueUs = arbiter_due_us(), packUs = pack_due_us(), spillUs = spill_due_us();
+            dueUs = packUs < dueUs ? packUs : dueUs;
+            dueUs = spillUs < dueUs ? spillUs : dueUs;
+            best_effort_wfe_or_timeout(make_timeout_time_us(dueUs < sleepUs ? dueUs : sleepUs));
+        }
+#endif
     } // poll loop
 } // main loop
 
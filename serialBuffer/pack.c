@@ -0,0 +1,178 @@
+// Radio packets, groups of whole frames sent back to back
+
+#include <string.h>
+#include "pack.h"
+#include "spill.h"
+#include "txeng.h"
+#include "cts.h"
+#include "timebase.h"
+
+_Static_assert(TXENG_FRAMES >= PACKET_FRAMES, "the engine takes a whole packet");
+
+static uint32_t packetMax, flushUs, gapUs;
+static bool adaptive;           // the window by CTS
+static struct {
+    frame_t frame[PACKET_FRAMES];
+    ring_span_t data[PACKET_FRAMES][2];
+    uint8_t copy[PACKET_FRAMES * FRAME_MAX];   // their bytes
+    int count;                  // frames collected
+    int handed;                 // of them handed to the engine
+    size_t bytes;
+    uint32_t firstUs;           // when the first frame was picked
+    bool full;
+    bool ctsHeld;               // was due while CTS was held
+} group;
+static struct {                 // picked, did not fit: the next group's first
+    frame_t frame;
+    ring_span_t data[2];
+    uint8_t copy[FRAME_MAX];
+    uint32_t pickedUs;
+    bool held;
+} carry;
+static bool lineBusy;           // a group handed over, not yet all in the UART
+static uint32_t quietUs;        // when it was
+static pack_stats_t counts;
+
+void pack_init(uint32_t max, uint32_t flush, uint32_t gap, bool byCts) {
+    packetMax = max;
+    adaptive = byCts && cts_watching();
+    flushUs = flush;
+    gapUs = gap;
+    memset(&group, 0, sizeof(group));
+    carry.held = false;
+    lineBusy = false;
+    quietUs = timebase_us() - gap;
+    memset(&counts, 0, sizeof(counts));
+}
+
+// A frame's bytes to buffer at to, data then spans them there
+static void copy(uint8_t *to, const frame_t *frame, ring_span_t data[2]) {
+    memcpy(to, data[0].data, data[0].len);
+    memcpy(to + data[0].len, data[1].data, data[1].len);
+    data[0].data = to;
+    data[0].len = frame->len;
+    data[1].data = NULL;
+    data[1].len = 0;
+}
+
+static void add(const frame_t *frame, const ring_span_t data[2], uint32_t pickedUs) {
+    if (group.count == 0) {
+        group.firstUs = pickedUs;
+    }
+    group.frame[group.count] = *frame;
+    group.data[group.count][0] = data[0];
+    group.data[group.count][1] = data[1];
+    copy(group.copy + group.bytes, frame, group.data[group.count]);
+    group.count++;
+    group.bytes += frame->len;
+    group.full = group.count == PACKET_FRAMES || group.bytes >= packetMax;
+}
+
+// Take frames from the arbiter (or the spill log) until the group is full. Each is copied
+// here and released at once: a group held while CTS is keeps no rx queue space (frameq.h),
+// and spill_poll() can free the bytes received after it.
+static void collect(void) {
+    frame_t frame;
+    ring_span_t data[2];
+    if (group.count == 0 && carry.held) {
+        add(&carry.frame, carry.data, carry.pickedUs);
+        carry.held = false;
+    }
+    while (!group.full && spill_next(&frame, data)) {
+        if (group.count > 0 && group.bytes + frame.len > packetMax) {   // Next time
+            carry.frame = frame;
+            carry.data[0] = data[0];
+            carry.data[1] = data[1];
+            copy(carry.copy, &frame, carry.data);
+            carry.pickedUs = timebase_us();
+            carry.held = true;
+            group.full = true;
+        } else {
+            add(&frame, data, timebase_us());           // Alone if longer than a packet
+        }
+        spill_release(&frame);
+    }
+}
+
+// Has the last group gone into the UART?
+static void watchLine(void) {
+    if (lineBusy && txeng_idle()) {
+        lineBusy = false;
+        quietUs = timebase_us();
+    }
+}
+
+// How long a group waits for more frames. Not adaptive, flushUs. Adaptive: none once
+// the link has been clear a packet cycle, the modem idle; after a cycle a quarter of one, at
+// most flushUs, for the frames that come soon after.
+static uint32_t window(uint32_t now) {
+    if (!adaptive) {
+        return flushUs;
+    }
+    uint32_t cycle = cts_mean_hold_us();
+    if (cts_clear_for_us(now) >= cycle) {
+        return 0;
+    }
+    return cycle / 4 < flushUs ? cycle / 4 : flushUs;
+}
+
+// Time left of period after elapsed
+static uint32_t left(uint32_t elapsed, uint32_t period) {
+    return elapsed >= period ? 0 : period - elapsed;
+}
+
+bool pack_next(frame_t *frame, ring_span_t data[2]) {
+    if (packetMax == 0) {                               // As picked, copied the same
+        if (!spill_next(frame, data)) {
+            return false;
+        }
+        copy(group.copy, frame, data);
+        spill_release(frame);
+        return true;
+    }
+    if (group.handed == 0) {                            // Not started: fill it, is it due?
+        watchLine();
+        collect();
+        uint32_t now = timebase_us();
+        counts.windowUs = window(now);
+        bool due = group.full || (group.count > 0 && now - group.firstUs >= counts.windowUs);
+        if (due && adaptive && cts_held()) {                        // The modem is busy: gather more, all
+            group.ctsHeld = true;                       // go when CTS comes back
+            return false;
+        }
+        if (!due || lineBusy || left(now - quietUs, gapUs) > 0) {
+            return false;
+        }
+        counts.packets++;
+        counts.flushed += !group.full;
+        counts.ctsHeld += group.ctsHeld;
+    }
+    *frame = group.frame[group.handed];
+    data[0] = group.data[group.handed][0];
+    data[1] = group.data[group.handed][1];
+    counts.frames++;
+    counts.bytes += frame->len;
+    if (++group.handed == group.count) {                // All handed over: the next group
+        group.count = group.handed = 0;
+        group.bytes = 0;
+        group.full = false;
+        group.ctsHeld = false;
+        lineBusy = true;
+    }
+    return true;
+}
+
+uint32_t pack_due_us(void) {
+    watchLine();
+    if (packetMax == 0 || lineBusy || (adaptive && cts_held()) || (group.count == 0 && !carry.held)) {
+        return UINT32_MAX;                              // Nothing, or the engine or CTS interrupts
+    }
+    uint32_t now = timebase_us();
+    uint32_t flush = group.full ? 0 : left(now - (group.count > 0 ? group.firstUs : carry.pickedUs), window(now));
+    uint32_t quiet = left(now - quietUs, gapUs);
+    return flush > quiet ? flush : quiet;
+}
+
+void pack_stats(pack_stats_t *stats) {
+    *stats = counts;
+}
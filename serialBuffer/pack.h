@@ -0,0 +1,51 @@
+#ifndef PACK_H
+#define PACK_H
+
+// Radio packets: the TinyMesh modem sends what it got over the serial line as a packet once
+// it holds a packet's payload, or once the line has been quiet for its packet timeout, and
+// then holds CTS low for the packet cycle (50 to 250 ms). A punch sent on its own costs a
+// cycle. Packing collects the frames the arbiter picks (through spill.h) into groups of
+// whole frames, at most packetMax bytes and PACKET_FRAMES frames, and hands them to the
+// transmit engine together, so they go back to back and the modem sends them as one packet.
+// A frame that does not fit starts the next group: no frame is split across packets. A
+// group goes when full, or flushUs after its first frame was picked. Between groups the
+// line stays quiet for gapUs, from when the engine has handed the last byte to the UART, so
+// the modem closes the packet before the next group comes.
+// Adaptive, with CTS watching (cts.h), the flush window adapts to the link: none once it
+// has been clear for a packet cycle, so a lone punch goes at once; a quarter of the learned
+// cycle, at most flushUs, just after one. While the modem holds CTS a due group is held
+// back and keeps gathering frames, to go in one burst when CTS comes back.
+// Frames are copied here as they are picked and released (spill_release) at once, so the
+// frames waiting in a group keep no queue space; the copy handed out by pack_next() stays
+// until the next call, for txeng_submit() to take its own.
+// Runs on the transmitting core, between spill_next() and txeng_submit().
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "frameq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t packets;           // groups handed to the engine
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t flushed;           // groups sent by the flush timer, not full
+    uint32_t ctsHeld;           // groups held back while CTS was held, gathering more
+    uint32_t windowUs;          // the flush window last chosen
+} pack_stats_t;
+
+// packetMax 0: off, frames go as picked. adaptive: the window by CTS, see above.
+void pack_init(uint32_t packetMax, uint32_t flushUs, uint32_t gapUs, bool adaptive);
+bool pack_next(frame_t *frame, ring_span_t data[2]);   // the next frame to submit, released already
+uint32_t pack_due_us(void);                             // until a group is due, UINT32_MAX if none
+void pack_stats(pack_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
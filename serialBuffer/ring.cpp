@@ -0,0 +1,62 @@
+// RingBuffer instances behind the C interface in ring.h.
+// The rings are static, so their storage is reserved at link time.
+
+#include <array>
+#include <utility>
+#include "ring.h"
+#include "ringbuffer.hpp"
+
+// The receive rings keep their bytes apart, each aligned to its size, so a DMA channel in
+// ring mode can write them directly (dmarx.h)
+using RxRing = RingBuffer<uint8_t, RX_QUEUE_SIZE, true>;
+static uint8_t rxStorage[Nchannels][RX_QUEUE_SIZE] __attribute__((aligned(RX_QUEUE_SIZE)));
+
+template <size_t... I>
+static constexpr std::array<RxRing, Nchannels> rxRings(std::index_sequence<I...>) {
+    return {{RxRing(rxStorage[I])...}};
+}
+
+static std::array<RxRing, Nchannels> rxRing = rxRings(std::make_index_sequence<Nchannels>());
+static RingBuffer<fq_desc_t, FRAME_QUEUE_SIZE> frameRing[Nchannels];
+
+// Room for every frame queue full at once, rounded up to a power of two
+static constexpr size_t pow2Above(size_t n, size_t p = 1) { return p >= n ? p : pow2Above(n, 2 * p); }
+static RingBuffer<uint8_t, pow2Above(Nchannels * FRAME_QUEUE_SIZE)> frameOrderRing[1];
+
+// Defines the functions declared by RING_DECLARE(name, type) on the ring array rings[]
+#define RING_DEFINE(name, type, rings) \
+    bool name##_put(int chan, type item) { return rings[chan].put(item); } \
+    bool name##_get(int chan, type *item) { return rings[chan].get(*item); } \
+    bool name##_peek(int chan, type *item) { return rings[chan].peek(*item); } \
+    size_t name##_count(int chan) { return rings[chan].count(); } \
+    size_t name##_space(int chan) { return rings[chan].space(); } \
+    size_t name##_write(int chan, const type *src, size_t n) { return rings[chan].write(src, n); } \
+    size_t name##_read(int chan, type *dst, size_t n) { return rings[chan].read(dst, n); } \
+    void name##_stats(int chan, ring_stats_t *stats) { *stats = rings[chan].stats(); }
+
+// ring_span_t is the C twin of RingSpan<uint8_t>
+static_assert(sizeof(ring_span_t) == sizeof(RingSpan<uint8_t>) &&
+              offsetof(ring_span_t, len) == offsetof(RingSpan<uint8_t>, len), "ring_span_t layout");
+#define AS_SPAN(span) reinterpret_cast<RingSpan<uint8_t> *>(span)
+
+// Defines the functions declared by RING_DECLARE_SPANS(name) on the byte ring array rings[]
+#define RING_DEFINE_SPANS(name, rings) \
+    size_t name##_read_spans(int chan, ring_span_t span[2]) { return rings[chan].readSpans(AS_SPAN(span)); } \
+    void name##_consume(int chan, size_t n) { rings[chan].consume(n); } \
+    size_t name##_write_spans(int chan, ring_span_t span[2]) { return rings[chan].writeSpans(AS_SPAN(span)); } \
+    void name##_produce(int chan, size_t n) { rings[chan].produce(n); }
+
+extern "C" {
+
+RING_DEFINE(rxq, uint8_t, rxRing)
+RING_DEFINE_SPANS(rxq, rxRing)
+uint8_t *rxq_storage(int chan) { return rxRing[chan].data(); }
+size_t rxq_produce_overwriting(int chan, size_t n) { return rxRing[chan].produceOverwriting(n); }
+size_t rxq_read_spans_from(int chan, size_t index, ring_span_t span[2]) {
+    return rxRing[chan].readSpansFrom(index, AS_SPAN(span));
+}
+void rxq_consume_to(int chan, size_t index) { rxRing[chan].consumeTo(index); }
+RING_DEFINE(fq, fq_desc_t, frameRing)
+RING_DEFINE(fqorder, uint8_t, frameOrderRing)
+
+}
\ No newline at end of file
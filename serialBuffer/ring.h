@@ -0,0 +1,74 @@
+#ifndef RING_H
+#define RING_H
+
+// C interface to the RingBuffer<T, N> instances (ringbuffer.hpp, ring.cpp) used by main.c.
+// Each queue family is an array of rings, one per channel, selected by the channel index.
+// The producer/consumer rules of RingBuffer apply per ring.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A contiguous run of bytes inside a ring's storage
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} ring_span_t;
+
+// Producer side accounting of a ring, see RingBuffer::stats()
+typedef struct {
+    uint32_t enqueued;          // elements accepted
+    uint32_t dropped;           // elements refused because the ring was full
+    uint32_t highWater;         // most elements ever waiting
+    uint32_t firstDropMs;       // time of the first and latest drop [ms since boot], 0 if none
+    uint32_t lastDropMs;
+} ring_stats_t;
+
+// Frame queue entry (frameq.c): a frame left in place in a channel's rx queue
+typedef struct {
+    uint32_t arrival;           // [us since boot]; with len 0: count of bytes to skip instead
+    uint16_t offset;            // first byte, index into the rx queue storage
+    uint16_t len;
+} fq_desc_t;
+
+// Declares <name>_put, _get, _peek, _count, _space, _write, _read and _stats for a family of <type> rings
+#define RING_DECLARE(name, type) \
+    bool name##_put(int chan, type item); \
+    bool name##_get(int chan, type *item); \
+    bool name##_peek(int chan, type *item); \
+    size_t name##_count(int chan); \
+    size_t name##_space(int chan); \
+    size_t name##_write(int chan, const type *src, size_t n); \
+    size_t name##_read(int chan, type *dst, size_t n); \
+    void name##_stats(int chan, ring_stats_t *stats);
+
+// Declares the zero copy span access of a family of byte rings
+#define RING_DECLARE_SPANS(name) \
+    size_t name##_read_spans(int chan, ring_span_t span[2]); \
+    void name##_consume(int chan, size_t n); \
+    size_t name##_write_spans(int chan, ring_span_t span[2]); \
+    void name##_produce(int chan, size_t n);
+
+RING_DECLARE(rxq, uint8_t)      // received bytes, RX_QUEUE_SIZE per channel
+RING_DECLARE_SPANS(rxq)
+RING_DECLARE(fq, fq_desc_t)     // frames waiting for transmission (frameq.c), FRAME_QUEUE_SIZE per channel
+RING_DECLARE(fqorder, uint8_t)  // channels in the order their frames were published (frameq.c), one ring: 0
+
+// Receive rings written by DMA (dmarx.h): the storage, RX_QUEUE_SIZE bytes aligned to their size,
+// and publishing bytes written there, see RingBuffer::produceOverwriting()
+uint8_t *rxq_storage(int chan);
+size_t rxq_produce_overwriting(int chan, size_t n);
+// Framing in place (framer.c, frameq.c), see RingBuffer::readSpansFrom() and consumeTo()
+size_t rxq_read_spans_from(int chan, size_t index, ring_span_t span[2]);
+void rxq_consume_to(int chan, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,263 @@
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+// Fixed capacity lock-free single producer / single consumer ring buffer.
+// Same ordering rules as the byte queue in fifo.c (release on publish, acquire on observe,
+// cached copy of the other side's index), but the capacity N is a compile time power of two:
+// head and tail run freely and are masked on access, so there is no % (a software divide on
+// the Cortex-M0+) and all N slots are usable.
+// Storage is part of the object; declare instances static to reserve them at link time.
+// With External set the storage is an array handed to the constructor instead, for storage
+// with placement constraints of its own (the DMA receive rings must be aligned to their size).
+// The producer side also keeps the ring's accounting (ring_stats_t): elements enqueued and
+// dropped, time of the first/latest drop and the high-water mark. The mark is tracked against
+// the cached tail, which is only refreshed when it would set a new mark.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "fifo.h"   // QUEUE_ALIGNED
+#include "ring.h"   // ring_stats_t
+#include "timebase.h"
+
+// A contiguous run of elements inside a ring's storage, see readSpans/writeSpans
+template <typename T>
+struct RingSpan {
+    T *data;
+    size_t len;
+};
+
+template <typename T, size_t N, bool External = false>
+class RingBuffer {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "RingBuffer elements are copied with memcpy");
+
+public:
+    static constexpr size_t capacity = N;
+
+    using Span = RingSpan<T>;
+
+    constexpr RingBuffer() = default;
+    constexpr explicit RingBuffer(T (&storage)[N]) : data_(storage) {
+        static_assert(External, "storage is part of the object");
+    }
+
+    // Base of the storage, e.g. for a DMA engine writing it
+    T *data() { return data_; }
+
+    // Producer side
+    bool put(const T &item) {
+        size_t head = load(&head_);
+        if (head - tailCache_ == N) {
+            tailCache_ = acquire(&tail_);
+            if (head - tailCache_ == N) {
+                drop(1);
+                return false;
+            }
+        }
+        data_[head & mask] = item;
+        release(&head_, head + 1);
+        account(head + 1, 1);
+        return true;
+    }
+
+    // Consumer side
+    bool get(T &item) {
+        size_t tail = load(&tail_);
+        if (!readable(tail)) {
+            return false;
+        }
+        item = data_[tail & mask];
+        release(&tail_, tail + 1);
+        return true;
+    }
+
+    bool peek(T &item) {
+        size_t tail = load(&tail_);
+        if (!readable(tail)) {
+            return false;
+        }
+        item = data_[tail & mask];
+        return true;
+    }
+
+    // Either side; a snapshot that the other side may change
+    size_t count() const { return acquire(&head_) - acquire(&tail_); }
+    size_t space() const { return N - count(); }
+    bool empty() const { return count() == 0; }
+
+    // Readable region from tail, at most two spans; release what was used with consume()
+    size_t readSpans(Span span[2]) {
+        size_t tail = load(&tail_);
+        size_t avail = (headCache_ = acquire(&head_)) - tail;
+        split(span, tail, avail);
+        return avail;
+    }
+
+    void consume(size_t n) {
+        release(&tail_, load(&tail_) + n);
+    }
+
+    // Writable region from head, at most two spans; publish what was filled with produce()
+    size_t writeSpans(Span span[2]) {
+        size_t head = load(&head_);
+        size_t avail = N - (head - (tailCache_ = acquire(&tail_)));
+        split(span, head, avail);
+        return avail;
+    }
+
+    void produce(size_t n) {
+        size_t head = load(&head_) + n;
+        release(&head_, head);
+        account(head, n);
+    }
+
+    // Elements written at head by an external writer (DMA) that does not look at the tail:
+    // publish n of them. Returns how many of them landed on unread elements, which count as
+    // dropped; count() then exceeds N and the readers skip the oldest count() - N.
+    size_t produceOverwriting(size_t n) {
+        size_t head = load(&head_) + n;
+        size_t over = head - acquire(&tail_);
+        size_t lost = over > N ? clamp(over - N, n) : 0;
+        release(&head_, head);
+        account(head, n);
+        if (lost) {
+            drop(lost);
+        }
+        return lost;
+    }
+
+    // A reader ahead of the consumer (one that leaves the elements in place for it):
+    // readable region from the free running index up to head. The consumer lets go of
+    // elements up to an index with consumeTo().
+    size_t readSpansFrom(size_t index, Span span[2]) {
+        size_t avail = acquire(&head_) - index;
+        split(span, index, avail < N ? avail : N);
+        return avail;
+    }
+
+    // Never back: an index at or behind the tail leaves it where it is
+    void consumeTo(size_t index) {
+        if (static_cast<ptrdiff_t>(index - load(&tail_)) > 0) {
+            release(&tail_, index);
+        }
+    }
+
+    // Bulk copy, returns the number of elements actually moved (less than n when empty/full)
+    size_t read(T *dst, size_t n) {
+        Span span[2];
+        n = clamp(n, readSpans(span));
+        copyOut(dst, span, n);
+        consume(n);
+        return n;
+    }
+
+    size_t write(const T *src, size_t n) {
+        Span span[2];
+        size_t done = clamp(n, writeSpans(span));
+        copyIn(span, src, done);
+        produce(done);
+        if (done < n) {
+            drop(n - done);
+        }
+        return done;
+    }
+
+    // Producer side accounting; read from elsewhere it is a snapshot
+    ring_stats_t stats() const { return stats_; }
+
+    // Move up to n elements from another ring (consumer of src, producer of this)
+    template <size_t M, bool E>
+    size_t moveFrom(RingBuffer<T, M, E> &src, size_t n) {
+        typename RingBuffer<T, M, E>::Span from[2];
+        Span to[2];
+        n = clamp(clamp(n, src.readSpans(from)), writeSpans(to));
+        size_t done = 0;
+        for (int i=0; i<2 && done<n; i++) {
+            size_t len = clamp(n - done, from[i].len);
+            Span part[2];
+            skip(part, to, done);
+            copyIn(part, from[i].data, len);
+            done += len;
+        }
+        src.consume(n);
+        produce(n);
+        return n;
+    }
+
+private:
+    static constexpr size_t mask = N - 1;
+
+    static size_t clamp(size_t n, size_t limit) { return n < limit ? n : limit; }
+    static size_t load(const size_t *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+    static size_t acquire(const size_t *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+    static void release(size_t *p, size_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+    // Count n elements published, head being the new head
+    void account(size_t head, size_t n) {
+        stats_.enqueued += n;
+        if (head - tailCache_ > stats_.highWater) {         // new mark, or a stale tail?
+            tailCache_ = acquire(&tail_);
+            if (head - tailCache_ > stats_.highWater) {
+                stats_.highWater = head - tailCache_;
+            }
+        }
+    }
+
+    void drop(size_t n) {
+        stats_.lastDropMs = timebase_ms();
+        if (stats_.dropped == 0) {
+            stats_.firstDropMs = stats_.lastDropMs;
+        }
+        stats_.dropped += n;
+    }
+
+    bool readable(size_t tail) {
+        if (tail == headCache_) {
+            headCache_ = acquire(&head_);
+        }
+        return tail != headCache_;
+    }
+
+    // Split len elements from free running index at the end of the storage
+    void split(Span span[2], size_t index, size_t len) {
+        size_t first = N - (index & mask);
+        span[0].data = &data_[index & mask];
+        span[0].len = clamp(len, first);
+        span[1].data = data_;
+        span[1].len = len - span[0].len;
+    }
+
+    // The spans after the first n elements
+    static void skip(Span out[2], const Span in[2], size_t n) {
+        if (n < in[0].len) {
+            out[0] = {in[0].data + n, in[0].len - n};
+            out[1] = in[1];
+        } else {
+            out[0] = {in[1].data + (n - in[0].len), in[1].len - (n - in[0].len)};
+            out[1] = {nullptr, 0};
+        }
+    }
+
+    static void copyOut(T *dst, const Span span[2], size_t n) {
+        size_t first = clamp(n, span[0].len);
+        memcpy(dst, span[0].data, first * sizeof(T));
+        memcpy(dst + first, span[1].data, (n - first) * sizeof(T));
+    }
+
+    static void copyIn(const Span span[2], const T *src, size_t n) {
+        size_t first = clamp(n, span[0].len);
+        memcpy(span[0].data, src, first * sizeof(T));
+        memcpy(span[1].data, src + first, (n - first) * sizeof(T));
+    }
+
+    size_t head_ QUEUE_ALIGNED = 0;     // producer: free running write index
+    size_t tailCache_ = 0;              // producer: last tail seen
+    ring_stats_t stats_ = {};           // producer: accounting
+    size_t tail_ QUEUE_ALIGNED = 0;     // consumer: free running read index
+    size_t headCache_ = 0;              // consumer: last head seen
+    typename std::conditional<External, T *, T[N]>::type data_ QUEUE_ALIGNED = {};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+// SportIdent CRC, the table generated at compile time
+
+#include <array>
+#include <utility>
+#include "sicrc.h"
+
+static constexpr uint16_t polynomial = 0x8005;
+
+// The register after shifting eight zero bits past high byte i
+static constexpr uint16_t entry(unsigned i) {
+    unsigned reg = i << 8;
+    for (int bit=0; bit<8; bit++) {
+        reg = reg & 0x8000 ? (reg << 1) ^ polynomial : reg << 1;
+    }
+    return reg & 0xFFFF;
+}
+
+template <size_t... I>
+static constexpr std::array<uint16_t, 256> makeTable(std::index_sequence<I...>) {
+    return {{entry(I)...}};
+}
+
+static constexpr std::array<uint16_t, 256> table = makeTable(std::make_index_sequence<256>());
+static_assert(table[0] == 0 && table[1] == polynomial, "CRC table");
+
+extern "C" {
+
+const uint16_t *const sicrc_table = table.data();
+
+uint16_t sicrc(const uint8_t *data, size_t count) {
+    uint16_t reg = 0;
+    for (size_t i=0; i<count; i++) {
+        reg = sicrc_byte(reg, data[i]);
+    }
+    return sicrc_end(reg, count);
+}
+
+}
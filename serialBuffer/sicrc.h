@@ -0,0 +1,38 @@
+#ifndef SICRC_H
+#define SICRC_H
+
+// SportIdent CRC (PC programmer's guide): polynomial 0x8005, MSB first, over the command
+// byte, the length byte and the data. The register starts at 0 and takes the bytes as they
+// come (sicrc_byte), then one zero byte, or two after an even count (sicrc_end); the guide
+// shifts the message in 16 bit words, the last one zero padded. A byte costs a lookup in a
+// table generated at compile time (sicrc.cpp).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const uint16_t *const sicrc_table;
+
+static inline uint16_t sicrc_byte(uint16_t reg, uint8_t byte) {
+    return (uint16_t)((reg << 8 | byte) ^ sicrc_table[reg >> 8]);
+}
+
+// The CRC of count bytes fed to reg
+static inline uint16_t sicrc_end(uint16_t reg, size_t count) {
+    if (count <= 2) {                   // As the guide: no padding, nothing for fewer
+        return count == 2 ? reg : 0;
+    }
+    reg = sicrc_byte(reg, 0);
+    return count & 1 ? reg : sicrc_byte(reg, 0);
+}
+
+uint16_t sicrc(const uint8_t *data, size_t count);     // of a whole message
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+// Spill to flash, the overflow path of the queues
+
+#include <string.h>
+#include "spill.h"
+#include "arbiter.h"
+
+#define READ_PAGES 2            // pages read back: one handing out frames, one with frames still being sent
+
+static uint32_t highRx, lowRx, highFrames, lowFrames;  // the marks
+static bool spilling;
+static struct {                 // taken from the arbiter, not yet in the log: the next one in
+    frame_t frame;
+    ring_span_t data[2];
+    bool held;
+} taken;
+static struct {
+    uint8_t page[FLASHLOG_PAGE];
+    size_t next;                // offset of the next record
+    int out;                    // frames handed out, not yet released
+} readBack[READ_PAGES];
+static int current;             // the page handing out frames
+static spill_stats_t counts;
+
+void spill_init(const flashlog_port_t *port, uint32_t size, uint32_t high, uint32_t low) {
+    flashlog_init(port, size);
+    highRx = RX_QUEUE_SIZE / 100 * high;
+    lowRx = RX_QUEUE_SIZE / 100 * low;
+    highFrames = FRAME_QUEUE_SIZE * high / 100;
+    lowFrames = FRAME_QUEUE_SIZE * low / 100;
+    spilling = false;
+    taken.held = false;
+    memset(readBack, 0, sizeof(readBack));
+    for (int i=0; i<READ_PAGES; i++) {
+        readBack[i].next = FLASHLOG_PAGE;
+    }
+    current = 0;
+    memset(&counts, 0, sizeof(counts));
+}
+
+// A channel's queues at the mark or above
+static bool over(uint32_t rxMark, uint32_t frameMark) {
+    for (int chan=0; chan<Nchannels; chan++) {
+        if (rxq_count(chan) >= rxMark || frameq_count(chan) >= frameMark) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The frame taken, as a record in the log; false if the log cannot take it now
+static bool put(void) {
+    const frame_t *frame = &taken.frame;
+    uint8_t *record = flashlog_reserve(SPILL_RECORD_HEAD + frame->len);
+    if (!record) {
+        return false;
+    }
+    record[0] = frame->len;
+    record[1] = frame->chan;
+    record[2] = frame->arrival;
+    record[3] = frame->arrival >> 8;
+    record[4] = frame->arrival >> 16;
+    record[5] = frame->arrival >> 24;
+    memcpy(record + SPILL_RECORD_HEAD, taken.data[0].data, taken.data[0].len);
+    memcpy(record + SPILL_RECORD_HEAD + taken.data[0].len, taken.data[1].data, taken.data[1].len);
+    counts.frames++;
+    counts.bytes += frame->len;
+    return true;
+}
+
+size_t spill_poll(void) {
+    size_t spilled = 0;
+    if (!flashlog_on()) {
+        return 0;
+    }
+    if (!spilling && over(highRx, highFrames)) {
+        spilling = true;
+        counts.spills++;
+    }
+    while (spilling || taken.held) {
+        if (!taken.held) {
+            if (!over(lowRx, lowFrames)) {              // Done: the last page may go to flash
+                spilling = false;
+                flashlog_seal();
+                break;
+            }
+            if (!arbiter_next(&taken.frame, taken.data)) {
+                break;
+            }
+            taken.held = true;
+        }
+        if (!put()) {                                   // The flash behind, or the log full
+            counts.waits++;
+            break;
+        }
+        frameq_release(&taken.frame);                   // Copied: its rx queue space is free
+        taken.held = false;
+        spilled++;
+    }
+    flashlog_poll();
+    return spilled;
+}
+
+// Is there a whole record at the read position?
+static bool hasRecord(int i) {
+    size_t at = readBack[i].next;
+    return at + SPILL_RECORD_HEAD <= FLASHLOG_PAGE && readBack[i].page[at] > 0 &&
+           at + SPILL_RECORD_HEAD + readBack[i].page[at] <= FLASHLOG_PAGE;
+}
+
+bool spill_next(frame_t *frame, ring_span_t data[2]) {
+    if (!flashlog_on()) {
+        return arbiter_next(frame, data);
+    }
+    while (!hasRecord(current)) {                       // This page done: the next one
+        int next = (current + 1) % READ_PAGES;
+        if (flashlog_pages() == 0 && !taken.held) {     // Nothing spilled: the queues'
+            return arbiter_next(frame, data);
+        }
+        if (readBack[next].out > 0 || !flashlog_read(readBack[next].page)) {
+            if (!spilling) {                            // The queued frames wait for the page filling
+                flashlog_seal();
+            }
+            return false;
+        }
+        readBack[next].next = FLASHLOG_HEAD;
+        current = next;
+    }
+    uint8_t *record = readBack[current].page + readBack[current].next;
+    frame->len = record[0];
+    frame->chan = record[1];
+    frame->arrival = record[2] | record[3] << 8 | record[4] << 16 | (uint32_t)record[5] << 24;
+    frame->offset = current;
+    frame->end = 0;
+    frame->spilled = true;
+    data[0].data = record + SPILL_RECORD_HEAD;
+    data[0].len = frame->len;
+    data[1].data = NULL;
+    data[1].len = 0;
+    readBack[current].next += SPILL_RECORD_HEAD + frame->len;
+    readBack[current].out++;
+    counts.drained++;
+    return true;
+}
+
+void spill_release(const frame_t *frame) {
+    if (frame->spilled) {
+        readBack[frame->offset].out--;
+    } else {
+        frameq_release(frame);
+    }
+}
+
+uint32_t spill_due_us(void) {
+    return flashlog_idle() && !taken.held ? UINT32_MAX : SPILL_POLL_US;
+}
+
+void spill_stats(spill_stats_t *stats) {
+    *stats = counts;
+    flashlog_stats(&stats->log);
+}
@@ -0,0 +1,53 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+// Spill to flash: the overflow path of the queues while the radio link is down or slower
+// than the SRRs. When a channel's rx queue or frame queue passes high percent full, frames
+// are taken from the arbiter as if to send them and written to the log in flash
+// (flashlog.h) instead, freeing their queue space, until every channel is below low percent.
+// A record per frame: its length, channel, arrival time and bytes. The transmit side takes
+// its frames here (spill_next): while the log holds frames they go first, read back page by
+// page, then the queues' again. The frames spilled are the oldest in the queues, so the log
+// only ever holds frames older than those still queued, and they go out in the order the
+// arbiter picked them. Spilling runs when the flash can take more; on the Pico the loop
+// waits out each erase or program while the rx DMA receives on (main.c). The frames in a
+// packet held while CTS is, and in the transmit engine, are copies (pack.h, txeng.h), so
+// each frame spilled frees its rx queue space at once.
+// Hardware independent; runs in the main loop on core0.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "frameq.h"
+#include "flashlog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPILL_RECORD_HEAD 6     // length, channel, arrival
+#define SPILL_POLL_US 1000      // while the flash has work, the loop looks this often
+
+typedef struct {
+    uint32_t spills;            // times a queue passed the high mark
+    uint32_t frames;            // frames written to the log
+    uint32_t bytes;
+    uint32_t drained;           // frames read back and handed out
+    uint32_t waits;             // passes a frame waited to go in, the flash behind or the log full
+    flashlog_stats_t log;
+} spill_stats_t;
+
+// The log on port, size bytes (flashlog_init), 0: off; the marks in percent full
+void spill_init(const flashlog_port_t *port, uint32_t size, uint32_t high, uint32_t low);
+
+size_t spill_poll(void);                                // main loop: spill, run the flash; frames spilled
+bool spill_next(frame_t *frame, ring_span_t data[2]);   // the next frame to send, arbiter_next if none spilled
+void spill_release(const frame_t *frame);               // sent: frameq_release, or free its log page
+uint32_t spill_due_us(void);                            // until the flash wants a poll, UINT32_MAX if idle
+void spill_stats(spill_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
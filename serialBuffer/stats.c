@@ -0,0 +1,106 @@
+// Status counters of the buffer, collected from the modules for reporting
+
+#include <stdio.h>
+#include "stats.h"
+#include "frameq.h"
+#include "dmarx.h"
+#include "timebase.h"
+#include "autobaud.h"
+
+void stats_collect(stats_t *stats) {
+    stats->timeMs = timebase_ms();
+    for (int chan=0; chan<Nchannels; chan++) {
+#if RX_DMA
+        dmarx_stats(chan, &stats->uart[chan]);
+#else
+        uartrx_stats(chan, &stats->uart[chan]);
+#endif
+        stats->baud[chan] = autobaud_rate(chan);
+        stats->baudLocked[chan] = autobaud_locked(chan);
+        rxq_stats(chan, &stats->rxQueue[chan]);
+        fq_stats(chan, &stats->frameQueue[chan]);
+        frameq_stats(chan, &stats->frames[chan]);
+        framer_stats(chan, &stats->punches[chan]);
+        stats->framesWaiting[chan] = frameq_count(chan);
+        arbiter_stats(chan, &stats->sent[chan]);
+    }
+    txeng_stats(&stats->tx);
+    dedup_stats(&stats->dedup);
+    pack_stats(&stats->packets);
+    wire_stats(&stats->wire);
+    cts_stats(&stats->cts);
+    link_stats(&stats->link);
+    spill_stats(&stats->spill);
+}
+
+void stats_print(const stats_t *stats) {
+    printf("t=%lu ms\n", (unsigned long)stats->timeMs);
+    for (int chan=0; chan<Nchannels; chan++) {
+        const ring_stats_t *rx = &stats->rxQueue[chan];
+        const ring_stats_t *fq = &stats->frameQueue[chan];
+        const frameq_stats_t *fr = &stats->frames[chan];
+        printf("ch%d rx: in=%lu drop=%lu hwm=%lu/%u drop@=%lu..%lu ms  frames: %lu wait=%lu hwm=%lu/%u lost=%lu+%lu unsent=%lu\n",
+               chan, (unsigned long)rx->enqueued, (unsigned long)rx->dropped,
+               (unsigned long)rx->highWater, RX_QUEUE_SIZE,
+               (unsigned long)rx->firstDropMs, (unsigned long)rx->lastDropMs, (unsigned long)fr->frames,
+               (unsigned long)stats->framesWaiting[chan], (unsigned long)fq->highWater, FRAME_QUEUE_SIZE,
+               (unsigned long)fr->skipped, (unsigned long)fr->overwritten, (unsigned long)fr->dropped);
+        const framer_stats_t *punches = &stats->punches[chan];
+        printf("ch%d punches: %lu crc ok=%lu bad=%lu dup=%lu\n", chan, (unsigned long)punches->punches,
+               (unsigned long)punches->valid, (unsigned long)punches->rejected, (unsigned long)punches->duplicates);
+        const arbiter_stats_t *sent = &stats->sent[chan];
+        printf("ch%d tx: frames=%lu wait: mean=%lu max=%lu us\n",
+               chan, (unsigned long)sent->frames,
+               (unsigned long)(sent->frames ? sent->sumWaitUs / sent->frames : 0), (unsigned long)sent->maxWaitUs);
+        const uartrx_stats_t *uart = &stats->uart[chan];
+        printf("ch%d uart: %lu baud%s irqs=%lu bytes=%lu overrun=%lu framing=%lu parity=%lu break=%lu\n",
+               chan, (unsigned long)stats->baud[chan], stats->baudLocked[chan] ? "" : " (detecting)",
+               (unsigned long)uart->irqs, (unsigned long)uart->bytes, (unsigned long)uart->overruns,
+               (unsigned long)uart->framingErrors, (unsigned long)uart->parityErrors, (unsigned long)uart->breaks);
+    }
+    const txeng_stats_t *tx = &stats->tx;
+    printf("tx: frames=%lu bytes=%lu back-to-back=%lu max=%lu us  wait: mean=%lu max=%lu us\n",
+           (unsigned long)tx->frames, (unsigned long)tx->bytes,
+           (unsigned long)tx->backToBack, (unsigned long)tx->maxFrameUs,
+           (unsigned long)(tx->submitted ? tx->sumWaitUs / tx->submitted : 0), (unsigned long)tx->maxWaitUs);
+    const dedup_stats_t *dup = &stats->dedup;
+    printf("dedup: punches=%lu duplicates=%lu (%lu.%lu%%) evicted=%lu\n",
+           (unsigned long)dup->punches, (unsigned long)dup->duplicates,
+           (unsigned long)(dup->punches ? dup->duplicates * 100ull / dup->punches : 0),
+           (unsigned long)(dup->punches ? dup->duplicates * 1000ull / dup->punches % 10 : 0),
+           (unsigned long)dup->evicted);
+    const pack_stats_t *pk = &stats->packets;
+    printf("packets: %lu frames=%lu bytes=%lu per packet: %lu frames %lu bytes  flushed=%lu\n",
+           (unsigned long)pk->packets, (unsigned long)pk->frames, (unsigned long)pk->bytes,
+           (unsigned long)(pk->packets ? pk->frames / pk->packets : 0),
+           (unsigned long)(pk->packets ? pk->bytes / pk->packets : 0), (unsigned long)pk->flushed);
+    const cts_stats_t *cts = &stats->cts;
+    printf("cts: holds=%lu hold: last=%lu mean=%lu max=%lu us held=%lu%%  window=%lu us held back=%lu\n",
+           (unsigned long)cts->holds, (unsigned long)cts->lastHoldUs, (unsigned long)cts->meanHoldUs,
+           (unsigned long)cts->maxHoldUs,
+           (unsigned long)(stats->timeMs ? cts->sumHoldUs / 10 / stats->timeMs : 0),
+           (unsigned long)pk->windowUs, (unsigned long)pk->ctsHeld);
+    const link_stats_t *link = &stats->link;
+    printf("link: sent=%lu drain=%lu in=%lu B/s  per window: mean=%lu max=%lu B (%lu)  ",
+           (unsigned long)link->sentBps, (unsigned long)link->drainBps, (unsigned long)link->inBps,
+           (unsigned long)link->windowBytes, (unsigned long)link->maxWindowBytes, (unsigned long)link->windows);
+    if (link->fullChan >= 0) {
+        printf("ch%d queues full in %lu s\n", link->fullChan, (unsigned long)link->fullInS);
+    } else {
+        printf("no rx queue growing\n");
+    }
+    const spill_stats_t *spill = &stats->spill;
+    if (spill->spills > 0) {
+        printf("spill: %lu times frames=%lu bytes=%lu drained=%lu waits=%lu  log: pages=%lu max=%lu programs=%lu erases=%lu full=%lu behind=%lu\n",
+               (unsigned long)spill->spills, (unsigned long)spill->frames, (unsigned long)spill->bytes,
+               (unsigned long)spill->drained, (unsigned long)spill->waits, (unsigned long)spill->log.pages,
+               (unsigned long)spill->log.maxPages, (unsigned long)spill->log.programs,
+               (unsigned long)spill->log.erases, (unsigned long)spill->log.full, (unsigned long)spill->log.behind);
+    }
+    const wire_stats_t *wire = &stats->wire;
+    if (wire->punches > 0) {
+        printf("wire: punches=%lu keyframes=%lu bytes in=%lu out=%lu (%lu%%)\n",
+               (unsigned long)wire->punches, (unsigned long)wire->keyframes, (unsigned long)wire->bytesIn,
+               (unsigned long)wire->bytesOut, (unsigned long)(wire->bytesOut * 100ull / wire->bytesIn));
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef STATS_H
+#define STATS_H
+
+// Status counters of the buffer, collected from the modules for reporting.
+// A snapshot: the counters keep running while they are collected.
+
+#include <stdint.h>
+#include "config.h"
+#include "ring.h"
+#include "uartrx.h"
+#include "frameq.h"
+#include "txeng.h"
+#include "arbiter.h"
+#include "framer.h"
+#include "dedup.h"
+#include "wire.h"
+#include "pack.h"
+#include "cts.h"
+#include "link.h"
+#include "spill.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t timeMs;                    // when collected [ms since boot]
+    uartrx_stats_t uart[Nchannels];     // UART reception and line errors
+    uint32_t baud[Nchannels];           // input rate, see autobaud.h
+    bool baudLocked[Nchannels];
+    ring_stats_t rxQueue[Nchannels];    // received bytes, until sent
+    ring_stats_t frameQueue[Nchannels]; // frame descriptors
+    frameq_stats_t frames[Nchannels];
+    framer_stats_t punches[Nchannels];  // punch CRC checks
+    uint32_t framesWaiting[Nchannels];
+    arbiter_stats_t sent[Nchannels];    // frames picked for transmission
+    txeng_stats_t tx;                   // transmission to the radio
+    dedup_stats_t dedup;                // duplicate punches, all channels
+    pack_stats_t packets;               // radio packets
+    wire_stats_t wire;                  // compact radio format
+    cts_stats_t cts;                    // the modem's flow control
+    link_stats_t link;                  // link rates and overflow forecast
+    spill_stats_t spill;                // frames spilled to flash
+} stats_t;
+
+void stats_collect(stats_t *stats);
+void stats_print(const stats_t *stats); // one line per channel via printf (USB serial)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,12 @@
+// Time source for the hardware independent modules, from the RP2040 timer
+
+#include "pico/time.h"
+#include "timebase.h"
+
+uint32_t timebase_us(void) {
+    return time_us_32();
+}
+
+uint32_t timebase_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
\ No newline at end of file
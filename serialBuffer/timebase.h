@@ -0,0 +1,20 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+// Time source for the hardware independent modules.
+// The firmware reads the RP2040 timer (timebase.c); host builds link a settable clock instead.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t timebase_us(void);     // microseconds since boot, wraps after 71 minutes; for intervals
+uint32_t timebase_ms(void);     // milliseconds since boot; for event timestamps
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
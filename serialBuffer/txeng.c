@@ -0,0 +1,78 @@
+// Transmit engine, hardware independent part.
+// Frames are taken in turn. submitted is written by the main loop, completed by the
+// interrupt; started by whichever side starts a frame. The main loop only starts one when
+// nothing is in flight, when no completion interrupt can come, so the two never race.
+
+#include <string.h>
+#include "txeng.h"
+#include "timebase.h"
+
+static const txeng_port_t *txPort;
+static struct {
+    uint8_t data[FRAME_MAX];    // the frame's bytes, copied
+    size_t len;
+} slot[TXENG_FRAMES];
+static uint32_t submitted;      // main loop: frames handed to the engine
+static uint32_t started;        // frames given to the DMA
+static uint32_t completed;      // interrupt: frames done
+static uint32_t startTime;      // of the frame in flight [us]
+static txeng_stats_t txStats;
+
+static uint32_t load(const uint32_t *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void store(uint32_t *p, uint32_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+// Give the next submitted frame to the DMA
+static void startNext(void) {
+    uint32_t next = started;
+    startTime = timebase_us();
+    store(&started, next + 1);
+    txPort->start(slot[next % TXENG_FRAMES].data, slot[next % TXENG_FRAMES].len);
+}
+
+void txeng_init(const txeng_port_t *port) {
+    txPort = port;
+}
+
+bool txeng_ready(void) {
+    return submitted - load(&completed) < TXENG_FRAMES;
+}
+
+void txeng_submit(const frame_t *frame, const ring_span_t data[2]) {
+    uint32_t wait = timebase_us() - frame->arrival;
+    txStats.submitted++;
+    txStats.sumWaitUs += wait;
+    if (wait > txStats.maxWaitUs) {
+        txStats.maxWaitUs = wait;
+    }
+    uint8_t *copy = slot[submitted % TXENG_FRAMES].data;
+    memcpy(copy, data[0].data, data[0].len);
+    memcpy(copy + data[0].len, data[1].data, data[1].len);
+    slot[submitted % TXENG_FRAMES].len = frame->len;
+    store(&submitted, submitted + 1);
+    uint32_t done = load(&completed);                   // before started, see above
+    if (load(&started) == done) {                       // line idle? Start here
+        startNext();
+    }
+}
+
+bool txeng_idle(void) {
+    return load(&completed) == load(&submitted);
+}
+
+void txeng_stats(txeng_stats_t *stats) {
+    *stats = txStats;
+}
+
+void txeng_irq(void) {
+    uint32_t us = timebase_us() - startTime;
+    txStats.frames++;
+    txStats.bytes += slot[completed % TXENG_FRAMES].len;
+    if (us > txStats.maxFrameUs) {
+        txStats.maxFrameUs = us;
+    }
+    store(&completed, completed + 1);
+    if (load(&submitted) != started) {                  // next one ready? Start it now
+        txStats.backToBack++;
+        startNext();
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef TXENG_H
+#define TXENG_H
+
+// Transmit engine: whole frames to the radio UART by DMA.
+// A frame is handed to a DMA channel paced by the UART TX DREQ, so no CPU runs per byte;
+// the UART's hardware CTS still holds the line. The engine takes a radio packet of frames
+// (PACKET_FRAMES): while one is being sent the next ones wait, and the DMA completion
+// interrupt (txeng_irq) starts the next at once. Each frame is copied into the engine when
+// submitted, so the caller may release it then: frames stalled behind CTS do not hold their
+// rx queue space, nor the bytes received after them (frameq.h). The DMA is reached through
+// a port (main.c on the Pico, a simulated DMA and UART in the host tests).
+// Completion means the last byte is in the UART TX FIFO, not yet on the line.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "frameq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TXENG_FRAMES (PACKET_FRAMES > 2 ? PACKET_FRAMES : 2)
+
+typedef struct {
+    void (*start)(const uint8_t *data, size_t len); // start the DMA, txeng_irq when done
+} txeng_port_t;
+
+typedef struct {
+    uint32_t submitted;         // frames given to the engine
+    uint32_t maxWaitUs;         // longest from frame arrival to submission
+    uint64_t sumWaitUs;         // for the mean over submitted
+    uint32_t frames;            // frames handed to the UART
+    uint32_t bytes;
+    uint32_t backToBack;        // frames started by the completion interrupt
+    uint32_t maxFrameUs;        // longest start to completion, CTS stalls included
+} txeng_stats_t;
+
+void txeng_init(const txeng_port_t *port);
+
+// Main loop
+bool txeng_ready(void);                                         // room for a frame
+void txeng_submit(const frame_t *frame, const ring_span_t data[2]); // send a copy of it
+bool txeng_idle(void);                                          // nothing queued or in flight
+void txeng_stats(txeng_stats_t *stats);
+
+// DMA completion interrupt
+void txeng_irq(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+// Interrupt driven UART reception, hardware independent part.
+// Runs in the UART interrupt as the producer of the channel's rx queue; the main loop
+// is the consumer, so no critical section is needed (see ringbuffer.hpp).
+
+#include "uartrx.h"
+#include "ring.h"
+
+static const uartrx_port_t *uartPort;
+static uartrx_stats_t rxStats[Nchannels];
+
+void uartrx_init(const uartrx_port_t *port) {
+    uartPort = port;
+}
+
+void uartrx_irq(int chan) {
+    uartrx_stats_t *s = &rxStats[chan];
+    uint8_t burst[UARTRX_FIFO_DEPTH];
+    size_t n = 0;
+
+    s->irqs++;
+    while (uartPort->readable(chan)) {                      // Drain the hardware FIFO
+        uint32_t dr = uartPort->read(chan);
+        if (dr & UARTRX_OE) {
+            s->overruns++;
+        }
+        if (dr & UARTRX_BE) {                               // Line held low, no character
+            s->breaks++;
+            continue;
+        }
+        if (dr & UARTRX_FE) {                               // Relayed anyway, like any other char
+            s->framingErrors++;
+        }
+        if (dr & UARTRX_PE) {
+            s->parityErrors++;
+        }
+        burst[n++] = (uint8_t)dr;
+        if (n == sizeof(burst)) {                           // FIFO refilled while draining
+            s->bytes += rxq_write(chan, burst, n);
+            n = 0;
+        }
+    }
+    s->bytes += rxq_write(chan, burst, n);                  // Overflow is counted by the rx queue
+}
+
+void uartrx_stats(int chan, uartrx_stats_t *stats) {
+    *stats = rxStats[chan];
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef UARTRX_H
+#define UARTRX_H
+
+// Interrupt driven UART reception.
+// The RX FIFO level and RX timeout interrupts of a channel call uartrx_irq, which drains
+// every character in the hardware FIFO into the channel's rx queue in one burst and counts
+// the error flags that come with each character. The UART registers are reached through a
+// port (main.c on the Pico, a simulated UART in the host tests).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Error flags above the character in the RP2040 (PL011) UART data register
+#define UARTRX_FE (1u << 8)     // framing error
+#define UARTRX_PE (1u << 9)     // parity error
+#define UARTRX_BE (1u << 10)    // break, no character
+#define UARTRX_OE (1u << 11)    // overrun, characters were lost after this one
+
+#define UARTRX_FIFO_DEPTH 32
+
+typedef struct {
+    bool (*readable)(int chan);     // RX FIFO not empty
+    uint32_t (*read)(int chan);     // pop the data register: character and error flags
+} uartrx_port_t;
+
+typedef struct {
+    uint32_t irqs;                  // handler invocations
+    uint32_t bytes;                 // characters moved to the rx queue
+    uint32_t framingErrors;
+    uint32_t parityErrors;
+    uint32_t breaks;
+    uint32_t overruns;              // hardware FIFO overflowed: characters lost
+} uartrx_stats_t;
+
+void uartrx_init(const uartrx_port_t *port);
+void uartrx_irq(int chan);                              // drain a channel's RX FIFO
+void uartrx_stats(int chan, uartrx_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
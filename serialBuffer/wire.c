@@ -0,0 +1,296 @@
+// Compact radio format of punches: the encoder of the firmware and the decoder of the
+// receiving computer, kept together so they change together
+
+#include <string.h>
+#include "wire.h"
+#include "sicrc.h"
+
+_Static_assert((WIRE_STATIONS & (WIRE_STATIONS - 1)) == 0, "WIRE_STATIONS must be a power of two");
+
+static const uint8_t STX      = 0x02;
+static const uint8_t ETX      = 0x03;
+static const uint8_t punchHdr = 0xD3;
+static const uint8_t punchLen = 13;
+// Positions from the header, as in framer.c
+enum {posCN = 2, posSN = 4, posTD = 8, posTH, posTL, posTSS, posMEM, posCRC = 15};
+
+#define CYCLE (4u * 7 * 2 * 43200 * 256)   // PUNCH_TIME_CYCLE
+#define DELTA_MAX (1 << 20)                 // |time delta| a 3 byte zigzag holds
+
+// The punch time of the TD, TH, TL and TSS fields, false if they would not come back the same
+static bool punchTime(const uint8_t *hdr, uint32_t *time) {
+    uint8_t td = hdr[posTD];
+    uint32_t seconds = hdr[posTH] << 8 | hdr[posTL];
+    if ((td & 0xC0) || ((td >> 1) & 7) == 7 || seconds >= 43200) {
+        return false;
+    }
+    uint32_t halfDays = (((td >> 4) & 3) * 7 + ((td >> 1) & 7)) * 2 + (td & 1);
+    *time = (halfDays * 43200 + seconds) * 256 + hdr[posTSS];
+    return true;
+}
+
+static void setTime(uint8_t *hdr, uint32_t time) {
+    uint32_t s = time / 256, halfDays = s / 43200, seconds = s % 43200, days = halfDays / 2;
+    hdr[posTD] = (days / 7) << 4 | (days % 7) << 1 | (halfDays & 1);
+    hdr[posTH] = seconds >> 8;
+    hdr[posTL] = seconds & 0xFF;
+    hdr[posTSS] = time & 0xFF;
+}
+
+static int32_t timeDiff(uint32_t a, uint32_t b) {
+    int32_t d = (int32_t)(a - b);
+    if (d > (int32_t)(CYCLE / 2)) {
+        d -= CYCLE;
+    } else if (d < -(int32_t)(CYCLE / 2)) {
+        d += CYCLE;
+    }
+    return d;
+}
+
+static uint32_t field(const uint8_t *p, int len) {
+    uint32_t v = 0;
+    for (int i=0; i<len; i++) {
+        v = v << 8 | p[i];
+    }
+    return v;
+}
+
+// Encoder
+
+typedef struct {
+    uint16_t station;
+    uint8_t chan;
+    uint8_t sn3;
+    bool used;
+    uint32_t since;             // punches coded on the keyframe
+    uint32_t time;              // of the keyframe
+    uint32_t mem;
+} station_t;
+
+static station_t stations[WIRE_STATIONS];      // latest keyframe by channel and station
+static uint32_t every;
+static wire_stats_t counts;
+
+void wire_init(uint32_t keyframeEvery) {
+    every = keyframeEvery;
+    memset(stations, 0, sizeof(stations));
+    memset(&counts, 0, sizeof(counts));
+}
+
+static station_t *lookup(int chan, uint16_t station) {
+    uint32_t h = ((uint32_t)station << 4 | chan) * 0x9E3779B1u;
+    return &stations[(h ^ h >> 16) & (WIRE_STATIONS - 1)];
+}
+
+bool wire_on(void) {
+    return every > 0;
+}
+
+size_t wire_encode(int chan, uint8_t *p, size_t len) {
+    if (every == 0 || (len != WIRE_PUNCH_MAX && len != WIRE_PUNCH_MAX - 2)) {  // Only punches
+        return len;
+    }
+    bool stx = len == WIRE_PUNCH_MAX;
+    const uint8_t *hdr = p + stx;
+    uint16_t cn = field(hdr + posCN, 2);
+    uint32_t mem = field(hdr + posMEM, 3), time;
+    station_t *st = lookup(chan, cn);
+    counts.punches++;
+    counts.bytesIn += len;
+    if (cn >= WIRE_STATIONS_ALL || !punchTime(hdr, &time)) {
+        counts.keyframes++;                             // Not for a record: in full
+        counts.bytesOut += len;
+        return len;
+    }
+    int32_t d = timeDiff(time, st->time);
+    if (!st->used || st->station != cn || st->chan != chan || st->since + 1 >= every ||
+        d < -DELTA_MAX || d >= DELTA_MAX) {
+        *st = (station_t){cn, (uint8_t)chan, hdr[posSN], true, 0, time, mem};
+        counts.keyframes++;                             // A new keyframe
+        counts.bytesOut += len;
+        return len;
+    }
+    st->since++;
+    uint8_t r[WIRE_RECORD_MAX];
+    size_t n = 0;
+    bool sn3 = hdr[posSN] != st->sn3;
+    r[n++] = WIRE_MARK | !stx << 3 | sn3 << 2 | hdr[posCN];
+    r[n++] = hdr[posCN + 1];
+    memcpy(&r[n], hdr + posSN + !sn3, 3 + sn3);
+    n += 3 + sn3;
+    uint32_t z = d >= 0 ? (uint32_t)d << 1 : ((uint32_t)-d << 1) - 1;
+    do {
+        r[n++] = (z & 0x7F) | (z > 0x7F ? 0x80 : 0);
+        z >>= 7;
+    } while (z);
+    uint32_t records = ((mem - st->mem) & 0xFFFFFF) / 8;
+    if (((mem - st->mem) & 7) == 0 && records >= 1 && records <= 127) {
+        r[n++] = records;
+    } else {
+        r[n++] = 0;
+        memcpy(&r[n], hdr + posMEM, 3);
+        n += 3;
+    }
+    r[n++] = hdr[posCRC];
+    r[n++] = hdr[posCRC + 1];
+    memcpy(p, r, n);
+    counts.bytesOut += n;
+    return n;
+}
+
+void wire_stats(wire_stats_t *stats) {
+    *stats = counts;
+}
+
+// Decoder
+
+void wire_decoder_init(wire_decoder_t *dec) {
+    memset(dec, 0, sizeof(*dec));
+}
+
+// A punch in full: the latest keyframe of its station
+static void learn(wire_decoder_t *dec, const uint8_t *hdr) {
+    uint16_t cn = field(hdr + posCN, 2);
+    wire_key_t key = {0, field(hdr + posMEM, 3), hdr[posSN], true};
+    if (cn >= WIRE_STATIONS_ALL || !punchTime(hdr, &key.time)) {
+        return;
+    }
+    wire_key_t *keys = dec->keys[cn];
+    int i = 0;
+    while (i < WIRE_KEYS - 1 && keys[i].used && !(keys[i].time == key.time && keys[i].mem == key.mem &&
+                                                  keys[i].sn3 == key.sn3)) {
+        i++;
+    }
+    memmove(&keys[1], &keys[0], i * sizeof(wire_key_t));
+    keys[0] = key;
+}
+
+// A punch in full at buf: its length, 0 if there is none, -1 if more bytes could make one
+static int rawPunch(const uint8_t *buf, size_t count) {
+    static const uint8_t head[3] = {STX, punchHdr, punchLen};
+    bool stx = buf[0] == STX;
+    size_t len = stx ? WIRE_PUNCH_MAX : WIRE_PUNCH_MAX - 2;
+    for (size_t i=0; i<2u + stx && i<count; i++) {
+        if (buf[i] != head[i + !stx]) {
+            return 0;
+        }
+    }
+    if (count < len) {
+        return -1;
+    }
+    uint16_t crc = sicrc(buf + stx, posCRC);
+    if (buf[stx + posCRC] != crc >> 8 || buf[stx + posCRC + 1] != (crc & 0xFF) ||
+        (stx && buf[len - 1] != ETX)) {
+        return 0;
+    }
+    return (int)len;
+}
+
+// A record at buf: its length with the punch rebuilt in punch, 0 if there is none or no
+// keyframe rebuilds it, -1 if more bytes could make one
+static int record(wire_decoder_t *dec, const uint8_t *buf, size_t count, uint8_t *punch, size_t *len) {
+    if ((buf[0] & 0xF0) != WIRE_MARK) {
+        return 0;
+    }
+    bool stx = !(buf[0] & 8), sn3 = buf[0] & 4;
+    size_t at = 2 + 3 + sn3;                            // The time
+    uint32_t z = 0;
+    for (int shift=0; ; shift+=7) {
+        if (shift == 21) {
+            return 0;
+        }
+        if (at >= count) {
+            return -1;
+        }
+        z |= (uint32_t)(buf[at] & 0x7F) << shift;
+        if (!(buf[at++] & 0x80)) {
+            break;
+        }
+    }
+    if (at >= count) {
+        return -1;
+    }
+    size_t memAt = at;
+    at += buf[at] ? 1 : 4;
+    at += 2;                                            // After the CRC
+    if (at > count) {
+        return -1;
+    }
+    uint16_t cn = (buf[0] & 3) << 8 | buf[1];
+    int32_t d = z & 1 ? -(int32_t)(z >> 1) - 1 : (int32_t)(z >> 1);
+    uint8_t *hdr = punch + stx;
+    punch[0] = STX;
+    hdr[0] = punchHdr;
+    hdr[1] = punchLen;
+    hdr[posCN] = cn >> 8;
+    hdr[posCN + 1] = cn & 0xFF;
+    memcpy(hdr + posSN + !sn3, buf + 2, 3 + sn3);
+    for (int k=0; k<WIRE_KEYS && dec->keys[cn][k].used; k++) {
+        const wire_key_t *key = &dec->keys[cn][k];
+        uint32_t mem = buf[memAt] ? key->mem + 8 * buf[memAt] : field(buf + memAt + 1, 3);
+        if (!sn3) {
+            hdr[posSN] = key->sn3;
+        }
+        setTime(hdr, (uint32_t)((key->time + (int64_t)CYCLE + d) % CYCLE));
+        hdr[posMEM] = mem >> 16;
+        hdr[posMEM + 1] = mem >> 8;
+        hdr[posMEM + 2] = mem;
+        uint16_t crc = sicrc(hdr, posCRC);
+        if (buf[at - 2] == crc >> 8 && buf[at - 1] == (crc & 0xFF)) {
+            hdr[posCRC] = crc >> 8;
+            hdr[posCRC + 1] = crc & 0xFF;
+            punch[WIRE_PUNCH_MAX - 1] = ETX;
+            *len = stx ? WIRE_PUNCH_MAX : WIRE_PUNCH_MAX - 2;
+            return (int)at;
+        }
+    }
+    dec->stats.unmatched++;
+    return 0;
+}
+
+// Pass on what the bytes waiting tell; flush: all of them
+static size_t settle(wire_decoder_t *dec, uint8_t *out, bool flush) {
+    size_t n = 0;
+    while (dec->count > 0) {
+        uint8_t punch[WIRE_PUNCH_MAX];
+        size_t len;
+        int used = rawPunch(dec->pending, dec->count);
+        if (used > 0) {
+            learn(dec, dec->pending + (dec->pending[0] == STX));
+            memcpy(out + n, dec->pending, used);
+            n += used;
+            dec->stats.punches++;
+        } else if (used == 0 && (used = record(dec, dec->pending, dec->count, punch, &len)) > 0) {
+            memcpy(out + n, punch, len);
+            n += len;
+            dec->stats.decoded++;
+        }
+        if (used < 0 && !flush) {                       // Wait for more
+            break;
+        }
+        if (used <= 0) {                                // Neither: a byte as received
+            out[n++] = dec->pending[0];
+            used = 1;
+        }
+        dec->count -= used;
+        memmove(dec->pending, dec->pending + used, dec->count);
+    }
+    return n;
+}
+
+size_t wire_decode(wire_decoder_t *dec, const uint8_t *in, size_t n, uint8_t *out) {
+    size_t done = 0;
+    for (size_t i=0; i<n; i++) {
+        dec->pending[dec->count++] = in[i];
+        done += settle(dec, out + done, false);
+    }
+    dec->stats.bytesIn += n;
+    dec->stats.bytesOut += done;
+    return done;
+}
+
+size_t wire_decode_flush(wire_decoder_t *dec, uint8_t *out) {
+    size_t done = settle(dec, out, true);
+    dec->stats.bytesOut += done;
+    return done;
+}
@@ -0,0 +1,99 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+// Compact radio format of punches, optional (WIRE_KEYFRAME): most of a punch repeats the
+// station's previous ones. Every keyframeEvery-th punch of a station on a channel goes in
+// full, as received: the keyframe. The others go as a record of what differs from the
+// channel's latest keyframe of the station, rewritten over the punch in the rx queue by
+// the framer, the rest of the punch dropped. Other bytes go as received.
+// A record, 9 to 15 bytes against 17 or 19:
+//   0xF0 | flags       bit3: no STX/ETX, bit2: SN3 follows, bits1..0: CN1
+//   CN0
+//   [SN3] SN2 SN1 SN0  SN3 only when not that of the keyframe
+//   time               punch time less the keyframe's, 1/256 s (framer_punch_time), zigzag
+//                      coded, 7 bits a byte, low first, bit7 set when more follow, 1 to 3 bytes
+//   mem                1..127: backup memory address less the keyframe's, in 8 byte records,
+//                      0: MEM2 MEM1 MEM0 follow
+//   CRC1 CRC0          of the punch, as the station sent it
+// The receiving computer passes the stream through the decoder, which gives back the punches
+// byte for byte. It keeps the latest WIRE_KEYS keyframes of each station and takes the one a
+// record rebuilds to the CRC it carries: punches of one station through several channels,
+// sent out of order by the arbiter, still decode. A lost keyframe costs the punches coded on
+// it, up to the next keyframe; a record that matches no keyframe goes on as received bytes.
+// A punch that does not fit the record (a TD with bits 7..6 set or day 7, seconds past the
+// half day, time too far from the keyframe's) goes in full, as a keyframe.
+// Encoder: runs on core1 (framer.c). Decoder: the receiving computer (wireDecode in
+// serialBufferTest), not part of the firmware.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIRE_MARK 0xF0              // first byte of a record, with its flags
+#define WIRE_RECORD_MAX 15
+#define WIRE_PUNCH_MAX 19
+
+typedef struct {
+    uint32_t punches;               // valid punches given to the encoder
+    uint32_t keyframes;             // of them sent in full
+    uint32_t bytesIn;               // of the punches
+    uint32_t bytesOut;              // sent for them
+} wire_stats_t;
+
+// Encoder
+void wire_init(uint32_t keyframeEvery);     // before the framer starts; 0: punches as received
+bool wire_on(void);
+
+// A valid punch of a channel, STX..ETX or D3..CRC1 CRC0 (len 19 or 17), in p: rewritten in
+// place as its record unless it goes in full. Returns the bytes to send of p.
+size_t wire_encode(int chan, uint8_t *p, size_t len);
+
+void wire_stats(wire_stats_t *stats);
+
+// Decoder, one per received stream
+#define WIRE_KEYS 4                 // keyframes kept per station
+#define WIRE_STATIONS_ALL 1024      // station codes a record can carry, CN1 two bits
+#define WIRE_PENDING 19             // bytes held back until they tell a punch or record
+#define WIRE_DECODE_ROOM(n) (3 * ((n) + WIRE_PENDING))     // output bytes from n input bytes
+
+typedef struct {
+    uint32_t time;                  // framer_punch_time() of the keyframe
+    uint32_t mem;                   // MEM2..MEM0
+    uint8_t sn3;
+    bool used;
+} wire_key_t;
+
+typedef struct {
+    uint32_t punches;               // passed on in full, keyframes
+    uint32_t decoded;               // rebuilt from records
+    uint32_t unmatched;             // records no keyframe rebuilds, passed on as bytes
+    uint32_t bytesIn;
+    uint32_t bytesOut;
+} wire_decoder_stats_t;
+
+typedef struct {
+    uint8_t pending[WIRE_PENDING];
+    size_t count;
+    wire_key_t keys[WIRE_STATIONS_ALL][WIRE_KEYS];      // most recent first
+    wire_decoder_stats_t stats;
+} wire_decoder_t;
+
+void wire_decoder_init(wire_decoder_t *dec);
+
+// Received bytes in, the bytes the stations sent out: returns their count, at most
+// WIRE_DECODE_ROOM(n). Bytes that may start a punch or record wait for the next call.
+size_t wire_decode(wire_decoder_t *dec, const uint8_t *in, size_t n, uint8_t *out);
+
+// The link went quiet: out with the bytes waiting, returns their count
+size_t wire_decode_flush(wire_decoder_t *dec, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -20,7 +20,8 @@ import generatePunches  # local file, function that simulates an SI station with
 # List of tests, specifying the number of punches in each test
 testList = [16, 128, 1024, 10*1024+10] 
 # The last test intentionally overflows the buffer, validating the test
-# With 2 x 10K buffer, we expect about 1200 punches before overflow
+# With 2 x 32K byte rx queues (RX_QUEUE_SIZE) and 19 byte punches, we expect about 3450
+# punches before overflow
 testList = [16, 16, 16, 16]
 #testList = [1, 1, 1, 1]
 #testList = [1]
@@ -105,8 +106,10 @@ def extractPunches(punchStream):
 		if punchStream[i+1] != generatePunches.punchHdr: # New, Header OK?
 			print("*** Error: punch header not found where expected") # No, flag error
 			return (punches)
-		punchLength = int(punchStream[i+2] +5) # Get punch length, add header, length and CRC 
-		punch = punchStream[i : i + punchLength] # Extract punch. TBD CRC check
+		punchLength = int(punchStream[i+2] +6) # Get punch length, add STX, header, length, CRC and ETX
+		punch = punchStream[i : i + punchLength] # Extract punch
+		if generatePunches.siCrc(list(punch[1:-3])) != (punch[-3] << 8 | punch[-2]):
+			print("*** Error: punch CRC wrong")
 		# print("Extracted punch # " + str(j) + " :" + str(punch))
 		i += punchLength 		# advance byte pointer to next punch 
 		punches.append(punch)	# Push punch to array
@@ -154,8 +157,8 @@ dummyBuffer = receiveAll()
 print ("DUT flushed: " + str(len(dummyBuffer)) + " bytes.")
 
 # Test with varying fill levels of the buffer. 
-# for a 10k char buffer plus UART internal buffers and 17 or 18 byte long punches,
-#  we expect failure at  700 punchs Txed without Rx 
+# for a 32k char rx queue per channel plus UART internal buffers and 19 byte long punches,
+#  we expect failure at about 1725 punches per channel Txed without Rx 
 # so the last test loads the buffer to failure, validating the test.
 for bufferLoad in testList:
 	# Fill the test buffer
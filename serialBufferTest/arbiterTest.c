@@ -0,0 +1,197 @@
+// 2023 FIF orientering
+// Host tests for the transmit arbiter (arbiter.c): the policies, and no starved channel
+
+#include "arbiter.h"
+#include "framer.h"
+#include "hostTime.h"
+#include "check.h"
+
+#define PUNCH_LEN 18
+#define FRAME_US 1000           // time to send a frame, one tick of the traffic simulation
+
+// Publish a punch on a channel, false when its frame queue is full
+static bool publish(int chan) {
+    if (fq_space(chan) == 0) {
+        return false;
+    }
+    for (int i=0; i<PUNCH_LEN; i++) {
+        rxq_put(chan, (uint8_t)chan);
+    }
+    return frameq_commit(chan, PUNCH_LEN, (uint32_t)hostTimeUs);
+}
+
+// Publish a punch punched at time [1/256 s in the week counter cycle]
+static void publishAt(int chan, uint32_t time) {
+    uint32_t halfDays = time / (43200 * 256), seconds = time / 256 % 43200;
+    uint8_t td = (halfDays / 14) << 4 | (halfDays % 14 / 2) << 1 | (halfDays & 1);
+    uint8_t punch[PUNCH_LEN] = {0x02, 0xD3, 0x0D, 0x00, chan, 0x00, 0x00, 0x00, 0x07,
+                                td, seconds >> 8, seconds & 0xFF, time & 0xFF, 0x00, 0x00, 0x07, 0xAB, 0xCD};
+    rxq_write(chan, punch, PUNCH_LEN);
+    frameq_commit(chan, PUNCH_LEN, (uint32_t)hostTimeUs);
+}
+
+// Channel of the next frame picked and sent, -1 if none
+static int next(void) {
+    frame_t frame;
+    ring_span_t data[2];
+    if (!arbiter_next(&frame, data)) {
+        return -1;
+    }
+    frameq_release(&frame);
+    return frame.chan;
+}
+
+static void testRoundRobin(void) {
+    arbiter_init(ARB_ROUND_ROBIN);
+    publish(0); publish(0); publish(0); publish(1);
+    CHECK(next() == 0);
+    CHECK(next() == 1);
+    CHECK(next() == 0);
+    CHECK(next() == 0);
+    CHECK(next() == -1);
+}
+
+static void testOldestFirst(void) {
+    arbiter_init(ARB_OLDEST_FIRST);
+    publish(1); publish(0); publish(0); publish(1); publish(1);
+    int order[] = {1, 0, 0, 1, 1};
+    for (int i=0; i<5; i++) {
+        CHECK(next() == order[i]);
+    }
+    CHECK(next() == -1);
+}
+
+// The oldest frame's channel has FRAMEQ_IN_FLIGHT frames out: it waits for one of them, the
+// younger frame of the other channel does not overtake it
+static void testOldestInFlight(void) {
+    frame_t out[FRAMEQ_IN_FLIGHT];
+    ring_span_t data[2];
+    arbiter_init(ARB_OLDEST_FIRST);
+    for (int i=0; i<=FRAMEQ_IN_FLIGHT; i++) {
+        publish(0);
+    }
+    publish(1);
+    bool taken = true;
+    for (int i=0; i<FRAMEQ_IN_FLIGHT; i++) {
+        taken &= arbiter_next(&out[i], data) && out[i].chan == 0;
+    }
+    CHECK(taken);
+    CHECK(next() == -1);
+    frameq_release(&out[0]);
+    CHECK(next() == 0);
+    CHECK(next() == 1);
+    for (int i=1; i<FRAMEQ_IN_FLIGHT; i++) {
+        frameq_release(&out[i]);
+    }
+    CHECK(next() == -1 && rxq_count(0) == 0 && rxq_count(1) == 0);
+}
+
+// A frame taken before its entry was recorded (published an instant ago, on the other core):
+// the entry is passed over when it comes, not taken for the channel's next frame
+static void testOldestLate(void) {
+    arbiter_init(ARB_OLDEST_FIRST);
+    frameq_order(false);
+    publish(0);
+    frameq_order(true);
+    CHECK(next() == 0);
+    fqorder_put(0, 0);                          // its entry, late
+    publish(1); publish(0);
+    CHECK(next() == 1);
+    CHECK(next() == 0);
+    CHECK(next() == -1);
+}
+
+static void testLongestQueue(void) {
+    arbiter_init(ARB_LONGEST_QUEUE);
+    publish(0); publish(0); publish(0); publish(1);
+    CHECK(next() == 0);
+    CHECK(next() == 0);
+    CHECK(next() == 1);         // tied at one each: in turn
+    CHECK(next() == 0);
+    CHECK(next() == -1);
+}
+
+static void testPunchTime(void) {
+    frame_t frame;
+    ring_span_t data[2];
+    uint32_t time;
+    arbiter_init(ARB_PUNCH_TIME);
+    // Backlogged channel 1 delivers its earlier punches late; the order comes from the punches
+    publishAt(0, 5000);
+    publishAt(0, 7000);
+    hostTimeUs += 100000;
+    publishAt(1, 4000);
+    publishAt(1, 6000);
+    uint32_t order[] = {4000, 5000, 6000};
+    for (int i=0; i<3; i++) {
+        CHECK(arbiter_next(&frame, data));
+        CHECK(framer_punch_time(data, frame.len, &time) && time == order[i]);
+        frameq_release(&frame);
+    }
+    // Channel 1 has nothing more: the last punch waits out the window, nothing earlier came
+    CHECK(!arbiter_next(&frame, data) && arbiter_due_us() == MERGE_WINDOW_MS * 1000u - 100000);
+    hostTimeUs += arbiter_due_us();
+    CHECK(arbiter_next(&frame, data) && framer_punch_time(data, frame.len, &time) && time == 7000);
+    frameq_release(&frame);
+    CHECK(!arbiter_next(&frame, data) && arbiter_due_us() == UINT32_MAX);
+    // Not a punch: at once
+    rxq_write(0, (const uint8_t *)"hello", 5);
+    frameq_commit(0, 5, (uint32_t)hostTimeUs);
+    CHECK(arbiter_next(&frame, data) && frame.len == 5);
+    frameq_release(&frame);
+    // Across the end of the week counter cycle
+    CHECK(framer_punch_time_diff(10, PUNCH_TIME_CYCLE - 10) == 20);
+    CHECK(framer_punch_time_diff(PUNCH_TIME_CYCLE - 10, 10) == -20);
+    CHECK(rxq_count(0) == 0 && rxq_count(1) == 0);
+}
+
+// A finish control next to a rarely used radio control: channel 0 offers twice what the
+// link carries, channel 1 a punch every 10 frame times. Returns channel 1's punches lost,
+// and the most of them waiting at once.
+static int hog(arb_policy_t policy, int *mostWaiting) {
+    arbiter_init(policy);
+    int lost = 0;
+    *mostWaiting = 0;
+    for (int tick=0; tick<4 * FRAME_QUEUE_SIZE; tick++) {
+        publish(0);
+        publish(0);
+        if (tick % 10 == 0 && !publish(1)) {
+            lost++;
+        }
+        if ((int)frameq_count(1) > *mostWaiting) {
+            *mostWaiting = frameq_count(1);
+        }
+        next();
+        hostTimeUs += FRAME_US;
+    }
+    while (next() >= 0) {
+    }
+    return lost;
+}
+
+static void testNoStarvation(void) {
+    arbiter_stats_t st;
+    int most;
+    CHECK(hog(ARB_ROUND_ROBIN, &most) == 0);
+    CHECK(most == 1);
+    arbiter_stats(1, &st);
+    CHECK(st.frames == (4 * FRAME_QUEUE_SIZE + 9) / 10 && st.maxWaitUs <= FRAME_US);    // within a frame time
+    arbiter_stats(0, &st);
+    CHECK(st.maxWaitUs >= (FRAME_QUEUE_SIZE - 1) * FRAME_US);
+
+    CHECK(hog(ARB_OLDEST_FIRST, &most) == 0);       // waits behind the backlog, not forever
+    arbiter_stats(1, &st);
+    CHECK(st.frames == (4 * FRAME_QUEUE_SIZE + 9) / 10 && st.maxWaitUs < 2 * FRAME_QUEUE_SIZE * FRAME_US);
+    CHECK(rxq_count(0) == 0 && rxq_count(1) == 0);
+}
+
+int main(void) {
+    testRoundRobin();
+    testOldestFirst();
+    testOldestInFlight();
+    testOldestLate();
+    testLongestQueue();
+    testNoStarvation();
+    testPunchTime();
+    return CHECK_REPORT("arbiterTest");
+}
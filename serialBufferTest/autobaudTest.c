@@ -0,0 +1,71 @@
+// 2023 FIF orientering
+// Host tests of the input baud rate detection (autobaud.c), alone and with the framer
+
+#include "autobaud.h"
+#include "framer.h"
+#include "frameq.h"
+#include "check.h"
+
+static const uint8_t punch[19] = {0x02, 0xD3, 0x0D, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07,
+                                  0x02, 0x10, 0x20, 0x30, 0x00, 0x00, 0x07, 0x4F, 0x20, 0x03};
+
+static void testFixed(void) {
+    autobaud_init(0, 4800);
+    CHECK(autobaud_locked(0) && autobaud_rate(0) == 4800);
+    CHECK(autobaud_poll(0, 0, 0, 0) == 0 && autobaud_poll(0, 1000, 100, 0) == 0);
+}
+
+static void testDetect(void) {
+    autobaud_init(1, AUTOBAUD);
+    CHECK(!autobaud_locked(1) && autobaud_rate(1) == 38400);
+    CHECK(autobaud_poll(1, 10, 1, 0) == 0);                         // where it starts
+    CHECK(autobaud_poll(1, 12, 1 + AUTOBAUD_ERRORS - 1, 0) == 0);
+    CHECK(autobaud_poll(1, 13, 1 + AUTOBAUD_ERRORS, 0) == 4800);    // too many framing errors
+    CHECK(autobaud_poll(1, 13, 5, 0) == 0);
+    CHECK(autobaud_poll(1, 13 + AUTOBAUD_BYTES, 5, 0) == 38400);    // bytes, but no punch: round again
+    CHECK(autobaud_poll(1, 100, 5, 0) == 0);
+    CHECK(autobaud_poll(1, 119, 5, 1) == 0 && autobaud_locked(1) && autobaud_rate(1) == 38400);
+    CHECK(autobaud_poll(1, 1000, 100, 1) == 0 && autobaud_rate(1) == 38400);   // for good
+}
+
+// A 4800 baud SRR: at 38400 each of its bits reads as a character, no punch header comes
+// through. At 4800 the punches frame, and the rate stays.
+static uint32_t valid(int chan) {
+    framer_stats_t st;
+    framer_stats(chan, &st);
+    return st.valid;
+}
+
+static void testWithFramer(void) {
+    frame_t frame;
+    ring_span_t data[2];
+    uint32_t bytes = 0, errors = 0, baud = 0;
+    autobaud_init(0, AUTOBAUD);
+    autobaud_poll(0, bytes, errors, valid(0));
+    for (int i=0; i<200 && !autobaud_locked(0); i++) {
+        if (autobaud_rate(0) == 38400) {                            // Bits as characters
+            uint8_t garbage[8] = {0x00, 0xFF, 0x80, 0xFE, 0x00, 0xF0, 0xFF, 0x00};
+            rxq_write(0, garbage, sizeof(garbage));
+            bytes += sizeof(garbage);
+            errors += 1;
+        } else {
+            rxq_write(0, punch, sizeof(punch));
+            bytes += sizeof(punch);
+        }
+        framer_run(0);
+        while (frameq_read(0, &frame, data)) {
+            frameq_release(&frame);
+        }
+        uint32_t set = autobaud_poll(0, bytes, errors, valid(0));
+        baud = set ? set : baud;
+    }
+    CHECK(autobaud_locked(0) && autobaud_rate(0) == 4800 && baud == 4800);
+    CHECK(valid(0) >= 1);
+}
+
+int main(void) {
+    testFixed();
+    testDetect();
+    testWithFramer();
+    return CHECK_REPORT("autobaudTest");
+}
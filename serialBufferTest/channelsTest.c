@@ -0,0 +1,160 @@
+// 2023 FIF orientering
+// Host model of a ten channel buffer (Nchannels=10): two UARTs (32 character FIFO, interrupt
+// at 16 or on RX timeout) and eight PIO receivers (8 character FIFO, interrupt when not
+// empty), all through uartrx.c, framer.c, frameq.c and the arbiter to one radio link.
+// Channel 0 is a finish control punching back to back, more than the link carries on its
+// own; the others punch now and then. The quiet channels must lose nothing and wait little.
+// Time runs in character times (260 us at 38400 baud); the radio takes a frame every
+// FRAME_CHARS.
+
+#include <string.h>
+#include "uartrx.h"
+#include "framer.h"
+#include "arbiter.h"
+#include "hostTime.h"
+#include "check.h"
+#include "punch.h"
+
+#define CHAR_US 260
+#define FRAME_CHARS 20
+#define QUIET_GAP 400           // character times between punches of a quiet channel
+#define STEPS 100000
+
+_Static_assert(Nchannels == 10, "built with every input");
+
+static struct {
+    uint32_t fifo[UARTRX_FIFO_DEPTH];
+    int depth;                  // 32 for a UART, 8 for a PIO receiver
+    int count;
+    int head;
+    int idle;                   // character times since the last arrival
+    uint8_t punch[PUNCH_LEN];   // being sent by the station
+    int sent;                   // characters of it on the line, PUNCH_LEN when done
+    uint32_t seq;               // punches started
+    uint32_t expect;            // next punch number at the radio
+    int lost;                   // punches missing at the radio
+} input[Nchannels];
+
+static bool simReadable(int chan) {
+    return input[chan].count > 0;
+}
+
+static uint32_t simRead(int chan) {
+    uint32_t dr = input[chan].fifo[input[chan].head];
+    input[chan].head = (input[chan].head + 1) % input[chan].depth;
+    input[chan].count--;
+    return dr;
+}
+
+static const uartrx_port_t simPort = {simReadable, simRead};
+
+// The station starts a punch: card number is the punch number, station code the channel
+static void startPunch(int chan) {
+    punch_make(input[chan].punch, chan, input[chan].seq++, 0, 0, 0);
+    input[chan].sent = 0;
+}
+
+// One character time of a channel's line and receiver
+static void lineStep(int chan, long t) {
+    bool busy = input[chan].sent < PUNCH_LEN;
+    if (!busy && (chan == 0 || t % QUIET_GAP == chan * 37)) {
+        startPunch(chan);
+        busy = true;
+    }
+    if (busy) {
+        input[chan].fifo[(input[chan].head + input[chan].count) % input[chan].depth] =
+            input[chan].punch[input[chan].sent++];
+        input[chan].count++;
+        input[chan].idle = 0;
+    } else {
+        input[chan].idle++;
+    }
+    bool uart = input[chan].depth == UARTRX_FIFO_DEPTH;
+    if (uart ? input[chan].count >= 16 || (input[chan].count > 0 && input[chan].idle >= 4)
+             : input[chan].count > 0) {
+        uartrx_irq(chan);
+    }
+}
+
+// The radio got a frame: a whole punch, in order on its channel. The hog overflows its
+// rx queue, so its punches may come cut.
+static bool check(const frame_t *frame, const ring_span_t data[2]) {
+    uint8_t p[PUNCH_LEN];
+    if (frame->chan == 0) {
+        return true;
+    }
+    if (frame->len != PUNCH_LEN) {
+        return false;
+    }
+    memcpy(p, data[0].data, data[0].len);
+    memcpy(p + data[0].len, data[1].data, data[1].len);
+    uint32_t n = (uint32_t)p[5] << 24 | p[6] << 16 | p[7] << 8 | p[8];
+    if (p[1] != 0xD3 || p[4] != frame->chan || n < input[frame->chan].expect) {
+        return false;
+    }
+    input[frame->chan].lost += n - input[frame->chan].expect;
+    input[frame->chan].expect = n + 1;
+    return true;
+}
+
+static void run(arb_policy_t policy) {
+    frame_t frame;
+    ring_span_t data[2];
+    bool onAir = false, intact = true;
+    arbiter_init(policy);
+    for (long t=0; t<STEPS; t++) {
+        hostTimeUs += CHAR_US;
+        for (int chan=0; chan<Nchannels; chan++) {          // Core1
+            lineStep(chan, t);
+            framer_run(chan);
+        }
+        if (t % FRAME_CHARS == 0) {                         // Core0, at the radio's pace
+            if (onAir) {
+                frameq_release(&frame);
+            }
+            onAir = arbiter_next(&frame, data);
+            if (onAir) {
+                intact &= check(&frame, data);
+            }
+        }
+    }
+    if (onAir) {
+        frameq_release(&frame);
+    }
+    for (int chan=0; chan<Nchannels; chan++) {              // The stations stopped: send the rest
+        while (framer_run(chan) > 0 || frameq_count(chan) > 0) {
+            while (arbiter_next(&frame, data)) {
+                intact &= check(&frame, data);
+                frameq_release(&frame);
+            }
+        }
+    }
+    CHECK(intact);
+}
+
+static void testFair(arb_policy_t policy, uint32_t maxWaitUs) {
+    arbiter_stats_t st;
+    memset(input, 0, sizeof(input));
+    for (int chan=0; chan<Nchannels; chan++) {
+        input[chan].depth = chan < 2 ? UARTRX_FIFO_DEPTH : 8;
+        input[chan].sent = PUNCH_LEN;
+    }
+    run(policy);
+    arbiter_stats(0, &st);
+    CHECK(st.frames > STEPS / FRAME_CHARS / 2);             // the hog gets the rest of the link
+    for (int chan=1; chan<Nchannels; chan++) {
+        arbiter_stats(chan, &st);
+        CHECK(input[chan].lost == 0 && st.frames == input[chan].seq);
+        CHECK(st.maxWaitUs <= maxWaitUs);
+    }
+}
+
+int main(void) {
+    uartrx_init(&simPort);
+    CHECK(RX_QUEUE_SIZE == 16 * 1024);                      // 160K of the 264K RAM
+    // In turn: a quiet punch goes within a round of all channels
+    testFair(ARB_ROUND_ROBIN, (Nchannels + 1) * FRAME_CHARS * CHAR_US);
+    // Oldest first: behind the hog's full frame queue and the quiet frames queued with it
+    testFair(ARB_OLDEST_FIRST, 2 * FRAME_QUEUE_SIZE * FRAME_CHARS * CHAR_US);
+    return CHECK_REPORT("channelsTest");
+}
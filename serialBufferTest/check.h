@@ -0,0 +1,17 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Minimal test helpers for the host tests: count failed checks, report at the end.
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+        printf("*** Error: %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+// Print the verdict and return the process exit code
+#define CHECK_REPORT(name) \
+    (printf(failures ? "*** " name " failed\n" : name " passed\n"), failures != 0)
+
+#endif
\ No newline at end of file
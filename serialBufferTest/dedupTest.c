@@ -0,0 +1,128 @@
+// 2023 FIF orientering
+// Host tests of the duplicate punch cache (dedup.c), alone and in the framer: a station
+// repeating its punches and a second receiver hearing the same ones, and valid frames other
+// than punches, never duplicates
+
+#include <string.h>
+#include "dedup.h"
+#include "framer.h"
+#include "frameq.h"
+#include "hostTime.h"
+#include "check.h"
+#include "punch.h"
+
+#define WINDOW_MS 1000
+
+static void testCache(void) {
+    dedup_stats_t st;
+    dedup_init(WINDOW_MS);
+    CHECK(!dedup_seen(31, 123456, 0x02102030, 0));
+    CHECK(dedup_seen(31, 123456, 0x02102030, 10));             // the same again
+    CHECK(!dedup_seen(32, 123456, 0x02102030, 20));            // other station,
+    CHECK(!dedup_seen(31, 123457, 0x02102030, 20));            // card
+    CHECK(!dedup_seen(31, 123456, 0x02102031, 20));            // or time
+    CHECK(dedup_seen(31, 123456, 0x02102030, 10 + WINDOW_MS - 1));
+    CHECK(!dedup_seen(31, 123456, 0x02102030, 10 + 2 * WINDOW_MS));    // window from the last sighting
+    dedup_stats(&st);
+    CHECK(st.punches == 7 && st.duplicates == 2 && st.evicted == 0);
+}
+
+// More punches within the window than the cache holds: the least recently seen go
+static void testEviction(void) {
+    const uint32_t n = 4 * DEDUP_SETS * DEDUP_WAYS;
+    dedup_stats_t st;
+    dedup_init(WINDOW_MS);
+    for (uint32_t card=0; card<n; card++) {
+        dedup_seen(1, card, 0, 0);
+    }
+    dedup_stats(&st);
+    CHECK(st.evicted >= n - DEDUP_SETS * DEDUP_WAYS);
+    int kept = 0;
+    for (uint32_t card=n - DEDUP_SETS; card<n; card++) {       // the latest are still there
+        kept += dedup_seen(1, card, 0, 1);
+    }
+    CHECK(kept == DEDUP_SETS);
+    CHECK(!dedup_seen(1, 0, 0, 1));                            // the first is not
+    dedup_init(0);                                             // off
+    CHECK(!dedup_seen(1, 5, 0, 0) && !dedup_seen(1, 5, 0, 0));
+}
+
+// Channel 0 hears each punch twice (the station repeats it), channel 1 hears them once (a
+// second receiver), with other bytes before some of them: every punch goes once, the other
+// bytes all go
+static void testFramer(void) {
+    uint8_t p[PUNCH_LEN], noise[3] = {0x55, 0x56, 0x57};
+    frame_t frame;
+    ring_span_t data[2];
+    size_t bytes = 0, noiseSeen = 0;
+    int count[100] = {0};
+    framer_stats_t st[2];
+    dedup_init(WINDOW_MS);
+    for (int card=0; card<100; card++) {
+        punch_make(p, 77, card, 0x02, card, 0);
+        rxq_write(0, p, PUNCH_LEN);
+        rxq_write(0, noise, sizeof(noise));
+        rxq_write(0, p, PUNCH_LEN);
+        rxq_write(1, p, PUNCH_LEN);
+        hostTimeUs += 10000;
+        for (int chan=0; chan<2; chan++) {
+            framer_run(chan);
+            while (frameq_count(chan) > 0) {
+                if (!frameq_read(chan, &frame, data)) {
+                    continue;                                   // a duplicate dropped
+                }
+                uint8_t f[FRAME_MAX];
+                memcpy(f, data[0].data, data[0].len);
+                memcpy(f + data[0].len, data[1].data, data[1].len);
+                if (frame.len == PUNCH_LEN && f[1] == 0xD3) {
+                    count[f[8]]++;                              // card, low byte
+                }
+                noiseSeen += frame.len == sizeof(noise) && f[0] == 0x55;
+                bytes += frame.len;
+                frameq_release(&frame);
+            }
+        }
+    }
+    bool once = true;
+    for (int card=0; card<100; card++) {
+        once &= count[card] == 1;
+    }
+    framer_stats(0, &st[0]);
+    framer_stats(1, &st[1]);
+    CHECK(once && noiseSeen == 100 && bytes == 100 * (PUNCH_LEN + sizeof(noise)));
+    CHECK(st[0].duplicates == 100 && st[1].duplicates == 100 && rxq_count(0) == 0 && rxq_count(1) == 0);
+}
+
+// Short valid frames that are not punches, the same bytes over again: all go
+static void testNotPunches(void) {
+    uint8_t f[10] = {0x02, 0xD3, 0x04, 0x11, 0x22, 0x33, 0x44, 0, 0, 0x03};   // STX D3 len 4 .. ETX
+    uint16_t crc = sicrc(f + 1, 6);
+    frame_t frame;
+    ring_span_t data[2];
+    framer_stats_t before, after;
+    int sent = 0;
+    f[7] = crc >> 8;
+    f[8] = crc & 0xFF;
+    dedup_init(WINDOW_MS);
+    framer_stats(0, &before);
+    for (int i=0; i<3; i++) {
+        rxq_write(0, f, sizeof(f));
+    }
+    framer_run(0);
+    while (frameq_read(0, &frame, data)) {
+        sent += frame.len == sizeof(f) && memcmp(data[0].data, f, data[0].len) == 0 &&
+                memcmp(data[1].data, f + data[0].len, data[1].len) == 0;
+        frameq_release(&frame);
+    }
+    framer_stats(0, &after);
+    CHECK(sent == 3 && after.valid == before.valid + 3 && after.duplicates == before.duplicates);
+    CHECK(rxq_count(0) == 0);
+}
+
+int main(void) {
+    testCache();
+    testEviction();
+    testFramer();
+    testNotPunches();
+    return CHECK_REPORT("dedupTest");
+}
@@ -0,0 +1,128 @@
+// 2023 FIF orientering
+// Host test of the DMA driven UART reception (dmarx.c) against a simulated DMA channel:
+// characters are written into the rx queue storage, wrapping at its end, while the
+// transfer count counts down, as an RP2040 DMA channel in ring mode does.
+
+#include <string.h>
+#include "dmarx.h"
+#include "ring.h"
+#include "check.h"
+
+static struct {
+    uint32_t count;             // transfer count register
+    uint32_t errors;            // UART receive status, cleared when read
+} dma[Nchannels];
+
+static uint32_t simTransferCount(int chan) {
+    return dma[chan].count;
+}
+
+static uint32_t simLineErrors(int chan) {
+    uint32_t errors = dma[chan].errors;
+    dma[chan].errors = 0;
+    return errors;
+}
+
+static const dmarx_port_t simPort = {simTransferCount, simLineErrors};
+
+// The DMA writes n characters
+static void simReceive(int chan, const uint8_t *data, size_t n) {
+    uint8_t *ring = rxq_storage(chan);
+    for (size_t i=0; i<n; i++) {
+        ring[(DMARX_COUNT - dma[chan].count) & (RX_QUEUE_SIZE - 1)] = data[i];
+        dma[chan].count--;
+    }
+}
+
+static uint8_t stream[3 * RX_QUEUE_SIZE];
+
+// Bursts of every size, polled and read in between, across several ring wraps
+static void testStream(void) {
+    uint8_t out[1024];
+    size_t sent = 0, got = 0, burst = 1;
+    bool same = true;
+    while (sent + burst <= sizeof(stream)) {
+        simReceive(0, &stream[sent], burst);
+        sent += burst;
+        CHECK(dmarx_poll(0) == burst);
+        size_t n = rxq_read(0, out, sizeof(out));
+        same &= memcmp(out, &stream[got], n) == 0;
+        got += n;
+        burst = burst % 1000 + 7;
+    }
+    CHECK(dmarx_poll(0) == 0);                          // nothing new
+    got += rxq_read(0, out, sizeof(out));
+    CHECK(same && got == sent);
+    uartrx_stats_t st;
+    ring_stats_t rs;
+    dmarx_stats(0, &st);
+    rxq_stats(0, &rs);
+    CHECK(st.bytes == sent && rs.enqueued == sent && rs.dropped == 0);
+}
+
+// Read all that is left of a channel's bytes from index *tail on, as the framing does:
+// what the DMA overwrote is skipped
+static size_t readNewest(int chan, size_t *tail, uint8_t *out) {
+    ring_span_t span[2];
+    size_t avail = rxq_read_spans_from(chan, *tail, span);
+    if (avail > RX_QUEUE_SIZE) {
+        *tail += avail - RX_QUEUE_SIZE;
+        avail = rxq_read_spans_from(chan, *tail, span);
+    }
+    memcpy(out, span[0].data, span[0].len);
+    memcpy(out + span[0].len, span[1].data, span[1].len);
+    *tail += avail;
+    rxq_consume_to(chan, *tail);
+    return avail;
+}
+
+// The reader falls behind: the DMA overwrites the oldest bytes, the newest ones survive
+static void testOverwrite(void) {
+    uint8_t out[RX_QUEUE_SIZE];
+    size_t n = RX_QUEUE_SIZE + 5000, tail = 0;
+    ring_stats_t rs;
+    simReceive(1, stream, 100);
+    dmarx_poll(1);
+    simReceive(1, stream + 100, n - 100);
+    dmarx_poll(1);
+    rxq_stats(1, &rs);
+    CHECK(rs.dropped == 5000);
+    CHECK(rxq_count(1) == n);                           // more than fit: the oldest are gone
+    CHECK(readNewest(1, &tail, out) == RX_QUEUE_SIZE);
+    CHECK(memcmp(out, stream + 5000, RX_QUEUE_SIZE) == 0);
+    // More than a whole lap between polls
+    simReceive(1, stream, sizeof(stream));
+    dmarx_poll(1);
+    CHECK(readNewest(1, &tail, out) == RX_QUEUE_SIZE);
+    CHECK(memcmp(out, stream + sizeof(stream) - RX_QUEUE_SIZE, RX_QUEUE_SIZE) == 0);
+    // Back in step afterwards
+    simReceive(1, stream, 18);
+    CHECK(dmarx_poll(1) == 18 && readNewest(1, &tail, out) == 18 && memcmp(out, stream, 18) == 0);
+    CHECK(rxq_count(1) == 0);
+}
+
+static void testLineErrors(void) {
+    uartrx_stats_t st;
+    dma[1].errors = UARTRX_FE | UARTRX_OE;
+    dmarx_poll(1);
+    dmarx_poll(1);                                      // already cleared
+    dma[1].errors = UARTRX_BE;
+    dmarx_poll(1);
+    dmarx_stats(1, &st);
+    CHECK(st.framingErrors == 1 && st.overruns == 1 && st.breaks == 1 && st.parityErrors == 0);
+}
+
+int main(void) {
+    for (size_t i=0; i<sizeof(stream); i++) {
+        stream[i] = (uint8_t)(i * 7 + i / 251);
+    }
+    for (int chan=0; chan<Nchannels; chan++) {
+        dma[chan].count = DMARX_COUNT;
+    }
+    dmarx_init(&simPort);
+    CHECK(((uintptr_t)rxq_storage(0) & (RX_QUEUE_SIZE - 1)) == 0);   // DMA ring alignment
+    testStream();
+    testOverwrite();
+    testLineErrors();
+    return CHECK_REPORT("dmarxTest");
+}
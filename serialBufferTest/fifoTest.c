@@ -0,0 +1,162 @@
+// 2023 FIF orientering
+// Host tests for the serialBuffer byte queue (fifo.c)
+// Single thread: wrap-around, zero bytes, bulk and span operations.
+// Two threads: one producer and one consumer hammer a queue with a known byte
+// sequence; the consumer verifies that nothing is lost, duplicated or reordered,
+// and the throughput is reported.
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "fifo.h"
+#include "check.h"
+
+// Byte sequence with no short period, so a lost or repeated byte is detected
+static inline uint8_t seqByte(uint64_t i) {
+    return (uint8_t)((i * 2654435761u) >> 13);
+}
+
+static void testSingleThread(void) {
+    static uint8_t storage[8];
+    queue_t q = QUEUE_INIT(storage);
+    uint8_t c;
+
+    CHECK(queue_read(&q, &c) == -1);                    // empty
+    CHECK(queue_write(&q, 0x00) == 0);                  // a zero byte is data, not "empty"
+    CHECK(queue_peek(&q, &c) == 0 && c == 0x00);
+    CHECK(queue_read(&q, &c) == 0 && c == 0x00);
+    for (int i=0; i<7; i++) {
+        CHECK(queue_write(&q, (uint8_t)i) == 0);
+    }
+    CHECK(queue_write(&q, 7) == -1);                    // size-1 entries usable
+    CHECK(queue_count(&q) == 7 && queue_space(&q) == 0);
+    for (int i=0; i<7; i++) {
+        CHECK(queue_read(&q, &c) == 0 && c == i);
+    }
+
+    // Spans across the wrap: tail and head are now at 0, move them to 5
+    uint8_t buf[16];
+    CHECK(queue_write_n(&q, (const uint8_t *)"abcde", 5) == 5);
+    CHECK(queue_read_n(&q, buf, 5) == 5);
+    CHECK(queue_write_n(&q, (const uint8_t *)"0123456789", 10) == 7);
+    queue_span_t span[2];
+    CHECK(queue_read_spans(&q, span) == 7);
+    CHECK(span[0].len == 3 && memcmp(span[0].data, "012", 3) == 0);
+    CHECK(span[1].len == 4 && memcmp(span[1].data, "3456", 4) == 0);
+    queue_consume(&q, 4);
+    CHECK(queue_write_spans(&q, span) == 4);
+    CHECK(span[0].len == 4 && span[1].len == 0);     // head 4, tail 1: one slot kept free
+    memcpy(span[0].data, "x", 1);
+    queue_produce(&q, 1);
+    CHECK(queue_read_n(&q, buf, sizeof(buf)) == 4 && memcmp(buf, "456x", 4) == 0);
+
+    // Move between queues
+    static uint8_t storage2[4];
+    queue_t q2 = QUEUE_INIT(storage2);
+    CHECK(queue_write_n(&q, (const uint8_t *)"ABCDEF", 6) == 6);
+    CHECK(queue_move(&q2, &q, 6) == 3);                 // destination holds 3
+    CHECK(queue_count(&q) == 3);
+    CHECK(queue_read_n(&q2, buf, 3) == 3 && memcmp(buf, "ABC", 3) == 0);
+}
+
+// Two thread stress test
+struct stressArgs {
+    queue_t *q;
+    uint64_t n;
+    uint64_t errors;
+};
+
+static void *producer(void *arg) {
+    struct stressArgs *a = arg;
+    uint8_t chunk[64];
+    uint64_t i = 0;
+    while (i < a->n) {
+        if (i & 0x100) {                            // alternate single byte and bulk writes
+            if (queue_write(a->q, seqByte(i)) == 0) {
+                i++;
+            } else {
+                sched_yield();                      // full: let the consumer run (also on one CPU)
+            }
+        } else {
+            size_t len = 1 + (i % sizeof(chunk));
+            if (len > a->n - i) {
+                len = a->n - i;
+            }
+            for (size_t k=0; k<len; k++) {
+                chunk[k] = seqByte(i + k);
+            }
+            size_t done = queue_write_n(a->q, chunk, len);
+            if (done == 0) {
+                sched_yield();
+            }
+            i += done;
+        }
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    struct stressArgs *a = arg;
+    uint64_t i = 0;
+    uint8_t c;
+    while (i < a->n) {
+        if (i & 0x80) {                             // alternate single byte and span reads
+            if (queue_read(a->q, &c) == 0) {
+                a->errors += (c != seqByte(i));
+                i++;
+            } else {
+                sched_yield();                      // empty: let the producer run
+            }
+        } else {
+            queue_span_t span[2];
+            size_t len = queue_read_spans(a->q, span);
+            size_t k = 0;
+            for (int s=0; s<2; s++) {
+                for (size_t j=0; j<span[s].len; j++, k++) {
+                    a->errors += (span[s].data[j] != seqByte(i + k));
+                }
+            }
+            queue_consume(a->q, len);
+            if (len == 0) {
+                sched_yield();
+            }
+            i += len;
+        }
+    }
+    return NULL;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void testTwoThreads(size_t size, uint64_t n) {
+    static uint8_t storage[1 << 16];
+    queue_t q = {.size = size, .data = storage};
+    struct stressArgs a = {&q, n, 0};
+    pthread_t p, c;
+
+    double start = now();
+    pthread_create(&c, NULL, consumer, &a);
+    pthread_create(&p, NULL, producer, &a);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    double elapsed = now() - start;
+
+    CHECK(a.errors == 0);
+    CHECK(queue_count(&q) == 0);
+    printf("SPSC size %6zu: %llu bytes, %llu errors, %.1f MB/s\n",
+           size, (unsigned long long)n, (unsigned long long)a.errors, n / elapsed / 1e6);
+}
+
+int main(void) {
+    testSingleThread();
+    testTwoThreads(16, 2000000);        // constantly full/empty, maximum contention
+    testTwoThreads(1024, 20000000);
+    testTwoThreads(1 << 16, 20000000);
+    return CHECK_REPORT("fifoTest");
+}
@@ -0,0 +1,64 @@
+// Simulated NOR flash standing in for the Pico's (main.c) in host builds
+
+#include <string.h>
+#include "flashSim.h"
+#include "hostTime.h"
+
+flash_sim_t flashSim;
+
+void flashsim_init(uint32_t eraseUs, uint32_t programUs) {
+    memset(&flashSim, 0, sizeof(flashSim));
+    memset(flashSim.mem, 0xFF, sizeof(flashSim.mem));
+    flashSim.eraseUs = eraseUs;
+    flashSim.programUs = programUs;
+}
+
+static bool busy(void) {
+    return hostTimeUs < flashSim.busyUntilUs;
+}
+
+// The caller waits for the operation, if so
+static void done(void) {
+    if (flashSim.wait) {
+        hostTimeUs = flashSim.busyUntilUs;
+    }
+}
+
+static void erase(uint32_t offset) {
+    if (busy() || offset % FLASHLOG_SECTOR != 0 || offset >= FLASHSIM_SIZE) {
+        flashSim.errors++;
+        return;
+    }
+    memset(flashSim.mem + offset, 0xFF, FLASHLOG_SECTOR);
+    flashSim.erases[offset / FLASHLOG_SECTOR]++;
+    flashSim.lastErase = offset;
+    flashSim.busyUntilUs = hostTimeUs + flashSim.eraseUs;
+    done();
+}
+
+static void program(uint32_t offset, const uint8_t *page) {
+    if (busy() || offset % FLASHLOG_PAGE != 0 || offset >= FLASHSIM_SIZE) {
+        flashSim.errors++;
+        return;
+    }
+    for (int i=0; i<FLASHLOG_PAGE; i++) {
+        if ((flashSim.mem[offset + i] & page[i]) != page[i]) {     // A 0 to 1 needs an erase
+            flashSim.errors++;
+        }
+        flashSim.mem[offset + i] &= page[i];
+    }
+    flashSim.lastProgram = offset;
+    flashSim.busyUntilUs = hostTimeUs + flashSim.programUs;
+    done();
+}
+
+static void read(uint32_t offset, uint8_t *data, size_t len) {
+    if (busy() || offset + len > FLASHSIM_SIZE) {
+        flashSim.errors++;
+        memset(data, 0xA5, len);
+        return;
+    }
+    memcpy(data, flashSim.mem + offset, len);
+}
+
+const flashlog_port_t flashSimPort = {erase, program, busy, read};
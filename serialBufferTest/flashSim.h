@@ -0,0 +1,43 @@
+#ifndef FLASHSIM_H
+#define FLASHSIM_H
+
+// Simulated NOR flash behind flashlog_port_t in host builds (flashSim.c): an erase sets a
+// sector to 0xFF, a program can only clear bits, and each keeps the flash busy for its time
+// on the host clock (hostTime.h). With wait set the caller waits it out instead, the host
+// clock moving on, as with the Pico's port (main.c). Misuse is counted, not done: an operation
+// or a read while busy, a program over bytes not erased.
+
+#include <stdint.h>
+#include "flashlog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASHSIM_SIZE (1024 * 1024)
+// W25Q16JV, the Pico's flash: typical and maximum times
+#define FLASHSIM_ERASE_US 45000
+#define FLASHSIM_ERASE_MAX_US 400000
+#define FLASHSIM_PROGRAM_US 400
+#define FLASHSIM_PROGRAM_MAX_US 3000
+
+typedef struct {
+    uint8_t mem[FLASHSIM_SIZE];
+    uint32_t eraseUs, programUs;        // operation times
+    uint64_t busyUntilUs;
+    bool wait;                          // operations done before they return
+    uint32_t errors;
+    uint32_t lastErase, lastProgram;    // offsets
+    uint32_t erases[FLASHSIM_SIZE / FLASHLOG_SECTOR];   // per sector
+} flash_sim_t;
+
+extern flash_sim_t flashSim;
+extern const flashlog_port_t flashSimPort;
+
+void flashsim_init(uint32_t eraseUs, uint32_t programUs);   // all erased, nothing counted, no wait
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
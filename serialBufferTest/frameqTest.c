@@ -0,0 +1,138 @@
+// 2023 FIF orientering
+// Host tests for the frame queue (frameq.c): descriptors of frames left in the rx queue
+
+#include <string.h>
+#include "frameq.h"
+#include "check.h"
+
+static const uint8_t punch[18] = {0x02, 0xD3, 0x0D, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07,
+                                  0x02, 0x10, 0x20, 0x30, 0x00, 0x00, 0x07, 0xAB, 0xCD};
+
+// Copy a frame's bytes out of its spans
+static size_t gather(uint8_t *dst, const ring_span_t data[2]) {
+    memcpy(dst, data[0].data, data[0].len);
+    memcpy(dst + data[0].len, data[1].data, data[1].len);
+    return data[0].len + data[1].len;
+}
+
+static void testInPlace(void) {
+    frame_t frame;
+    ring_span_t data[2];
+
+    CHECK(frameq_count(0) == 0 && !frameq_read(0, &frame, data));
+    rxq_write(0, punch, sizeof(punch));
+    CHECK(frameq_commit(0, sizeof(punch), 0x12345678));
+    CHECK(!frameq_commit(0, 0, 0) && !frameq_commit(0, FRAME_MAX + 1, 0));   // no empty or oversized frames
+    CHECK(frameq_count(0) == 1);
+    CHECK(frameq_read(0, &frame, data));
+    CHECK(frame.arrival == 0x12345678 && frame.chan == 0 && frame.len == sizeof(punch));
+    CHECK(frame.offset == 0 && frame.end == sizeof(punch));
+    CHECK(data[0].data == rxq_storage(0) && data[0].len == sizeof(punch) && data[1].len == 0);
+    CHECK(memcmp(data[0].data, punch, sizeof(punch)) == 0);     // not copied
+    CHECK(frameq_count(0) == 0 && rxq_count(0) == sizeof(punch));  // held until sent
+    frameq_release(&frame);
+    CHECK(rxq_count(0) == 0);
+}
+
+// Frames across the rx queue end, two in flight at a time, released in order
+static void testWrap(void) {
+    frame_t a, b;
+    ring_span_t data[2];
+    uint8_t buf[FRAME_MAX];
+    bool same = true, wrapped = false;
+    for (int i=0; i<RX_QUEUE_SIZE / (int)sizeof(punch) * 3; i += 2) {
+        rxq_write(1, punch, sizeof(punch));
+        rxq_write(1, punch, sizeof(punch));
+        CHECK(frameq_commit(1, sizeof(punch), i) && frameq_commit(1, sizeof(punch), i + 1));
+        CHECK(frameq_read(1, &a, data));
+        wrapped |= data[1].len > 0;
+        same &= gather(buf, data) == sizeof(punch) && memcmp(buf, punch, sizeof(punch)) == 0;
+        CHECK(frameq_read(1, &b, data));
+        same &= gather(buf, data) == sizeof(punch) && memcmp(buf, punch, sizeof(punch)) == 0;
+        same &= a.arrival == (uint32_t)i && b.arrival == (uint32_t)i + 1 && a.end == b.end - sizeof(punch);
+        frameq_release(&a);
+        same &= rxq_count(1) == sizeof(punch);
+        frameq_release(&b);
+    }
+    CHECK(same && wrapped && rxq_count(1) == 0);
+}
+
+// Lost bytes between frames: never read, freed with the frames around them
+static void testSkip(void) {
+    frame_t a, b;
+    ring_span_t data[2];
+    frameq_stats_t st;
+    uint8_t noise[10] = {0};
+    rxq_write(0, punch, sizeof(punch));
+    rxq_write(0, noise, sizeof(noise));
+    rxq_write(0, punch, sizeof(punch));
+    CHECK(frameq_commit(0, sizeof(punch), 1) && frameq_skip(0, sizeof(noise)) && frameq_commit(0, sizeof(punch), 2));
+    CHECK(frameq_read(0, &a, data) && frameq_read(0, &b, data));
+    CHECK(a.arrival == 1 && b.arrival == 2 && b.offset == a.offset + sizeof(punch) + sizeof(noise));
+    CHECK(memcmp(data[0].data, punch, sizeof(punch)) == 0);
+    frameq_release(&a);
+    CHECK(rxq_count(0) == sizeof(punch) + sizeof(noise));
+    frameq_release(&b);
+    CHECK(rxq_count(0) == 0);
+    // Nothing in flight: freed when read past
+    rxq_write(0, noise, sizeof(noise));
+    CHECK(frameq_skip(0, sizeof(noise)));
+    CHECK(!frameq_read(0, &a, data) && rxq_count(0) == 0);
+    frameq_stats(0, &st);
+    CHECK(st.frames == 3 && st.skipped == 2 * sizeof(noise) && st.overwritten == 0);
+}
+
+// Released out of order (a frame spilled while older ones wait in a packet): space freed up
+// to the oldest frame in flight only; at most FRAMEQ_IN_FLIGHT read and not released
+static void testOutOfOrder(void) {
+    frame_t frame[FRAMEQ_IN_FLIGHT + 1];
+    ring_span_t data[2];
+    for (int i=0; i<=FRAMEQ_IN_FLIGHT; i++) {
+        rxq_write(0, punch, sizeof(punch));
+        CHECK(frameq_commit(0, sizeof(punch), i));
+    }
+    int n = 0;
+    while (n <= FRAMEQ_IN_FLIGHT && frameq_read(0, &frame[n], data)) {
+        n++;
+    }
+    CHECK(n == FRAMEQ_IN_FLIGHT && frameq_count(0) == 1);
+    frameq_release(&frame[2]);
+    CHECK(rxq_count(0) == (FRAMEQ_IN_FLIGHT + 1) * sizeof(punch));
+    frameq_release(&frame[0]);
+    CHECK(rxq_count(0) == FRAMEQ_IN_FLIGHT * sizeof(punch));    // frame 1 holds its bytes, and 2's
+    frameq_release(&frame[1]);
+    CHECK(rxq_count(0) == (FRAMEQ_IN_FLIGHT - 2) * sizeof(punch));
+    for (int i=n - 1; i>2; i--) {                               // Newest first: none freed till the last
+        frameq_release(&frame[i]);
+        CHECK(rxq_count(0) == (i > 3 ? FRAMEQ_IN_FLIGHT - 2 : 1) * sizeof(punch));
+    }
+    CHECK(frameq_read(0, &frame[0], data));
+    frameq_release(&frame[0]);
+    CHECK(rxq_count(0) == 0);
+}
+
+// The descriptor ring holds FRAME_QUEUE_SIZE frames
+static void testFull(void) {
+    frame_t frame;
+    ring_span_t data[2];
+    int n = 0;
+    while (frameq_commit(0, 1, 0)) {
+        rxq_put(0, 0x55);
+        n++;
+    }
+    CHECK(n == FRAME_QUEUE_SIZE && frameq_count(0) == FRAME_QUEUE_SIZE);
+    while (frameq_read(0, &frame, data)) {
+        frameq_release(&frame);
+        n--;
+    }
+    CHECK(n == 0 && rxq_count(0) == 0);
+}
+
+int main(void) {
+    testInPlace();
+    testWrap();
+    testSkip();
+    testOutOfOrder();
+    testFull();
+    return CHECK_REPORT("frameqTest");
+}
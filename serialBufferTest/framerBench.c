@@ -0,0 +1,60 @@
+// 2023 FIF orientering
+// Host benchmark of the punch framing (framer.c): frames/s and main loop passes per frame
+// of the batch framing (framer_run) against the state machine taking one step per pass
+// (framer_step, the earlier framing), for a backlog of punches waiting in the rx queue.
+// Each pass also empties the frame queue and releases the frames, as the transmitter
+// would. Prints CSV.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "framer.h"
+#include "frameq.h"
+#include "ring.h"
+
+#define PUNCH_LEN 19
+#define BACKLOG 1000            // punches waiting, 19K of the 32K rx queue
+#define ROUNDS 50
+
+static const uint8_t punch[PUNCH_LEN] = {0x02, 0xD3, 0x0D, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07,
+                                         0x02, 0x10, 0x20, 0x30, 0x00, 0x00, 0x07, 0x4F, 0x20, 0x03};
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void bench(const char *name, bool batch) {
+    ring_span_t data[2];
+    frame_t frame;
+    uint64_t ns = 0, passes = 0, frames = 0;
+    for (int round=0; round<ROUNDS; round++) {
+        for (int i=0; i<BACKLOG; i++) {
+            rxq_write(0, punch, PUNCH_LEN);
+        }
+        uint64_t start = nowNs();
+        while (rxq_count(0) > 0) {
+            if (batch) {
+                framer_run(0);
+            } else {
+                framer_step(0);
+            }
+            while (frameq_read(0, &frame, data)) {
+                frameq_release(&frame);
+                frames++;
+            }
+            passes++;
+        }
+        ns += nowNs() - start;
+    }
+    printf("%s,%llu,%.0f,%.3f,%.1f\n", name, (unsigned long long)frames, frames * 1e9 / ns,
+           (double)passes / frames, (double)ns / frames);
+}
+
+int main(void) {
+    printf("framing,frames,frames_per_s,passes_per_frame,ns_per_frame\n");
+    bench("step", false);
+    bench("batch", true);
+    return 0;
+}
@@ -0,0 +1,221 @@
+// 2023 FIF orientering
+// Host tests of the punch framing (framer.c): batch framing against the byte at a time
+// state machine, rx ring wrap, a full frame queue, non-punch data, valid frames of other
+// lengths than a punch's, the two core split and bytes lost to the rx DMA.
+
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "framer.h"
+#include "frameq.h"
+#include "ring.h"
+#include "wire.h"
+#include "check.h"
+#include "punch.h"
+
+static const uint8_t punch[PUNCH_LEN] = {0x02, 0xD3, 0x0D, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07,
+                                         0x02, 0x10, 0x20, 0x30, 0x00, 0x00, 0x07, 0x4F, 0x20, 0x03};
+
+static uint8_t stream[48 * 1024];      // more than the rx ring, so it wraps
+static uint8_t frames[2][64 * 1024];        // frames seen per channel, each prefixed by its length
+
+// Punches with some noise between them (never a header), n bytes
+static size_t makeStream(size_t n) {
+    size_t len = 0;
+    unsigned seed = 1;
+    while (len + PUNCH_LEN + 8 <= n) {
+        seed = seed * 1103515245 + 12345;
+        int noise = (seed >> 16) % 4 == 0 ? (seed >> 20) % 8 : 0;
+        for (int i=0; i<noise; i++) {
+            stream[len++] = 0x55;
+        }
+        memcpy(stream + len, punch, PUNCH_LEN);
+        stream[len + 3] = (uint8_t)len;         // tell the punches apart
+        punch_seal(stream + len);
+        len += PUNCH_LEN;
+    }
+    return len;
+}
+
+// Read the waiting frames of a channel into frames[chan] at *pos, each prefixed by its
+// length, and release them as the transmitter does. Returns the count.
+static int drain(int chan, size_t *pos) {
+    frame_t frame;
+    ring_span_t data[2];
+    int n = 0;
+    while (frameq_read(chan, &frame, data)) {
+        frames[chan][*pos] = frame.len;
+        memcpy(&frames[chan][*pos + 1], data[0].data, data[0].len);
+        memcpy(&frames[chan][*pos + 1 + data[0].len], data[1].data, data[1].len);
+        *pos += frame.len + 1;
+        frameq_release(&frame);
+        n++;
+    }
+    return n;
+}
+
+// The same stream through both channels, batch on 0 and byte at a time on 1, fed in
+// pieces across several rx ring wraps: same frames, every punch a frame of its own
+static void testBatchMatchesStep(void) {
+    size_t len = makeStream(sizeof(stream));
+    size_t fed = 0, pos[2] = {0, 0};
+    int count[2] = {0, 0}, piece = 1;
+    while (fed < len) {
+        size_t n = len - fed < (size_t)piece ? len - fed : (size_t)piece;
+        CHECK(rxq_write(0, stream + fed, n) == n && rxq_write(1, stream + fed, n) == n);
+        fed += n;
+        piece = piece % 700 + 13;
+        framer_run(0);
+        while (framer_step(1)) {
+        }
+        count[0] += drain(0, &pos[0]);
+        count[1] += drain(1, &pos[1]);
+    }
+    CHECK(count[0] == count[1] && pos[0] == pos[1]);
+    CHECK(memcmp(frames[0], frames[1], pos[0]) == 0);
+    CHECK(rxq_count(0) == 0);                          // all sent and released
+    // Each punch ends a frame, the noise before it is relayed in the same frame
+    size_t at = 0, punches = 0;
+    bool whole = true;
+    while (at < pos[0]) {
+        uint8_t flen = frames[0][at];
+        whole &= flen >= PUNCH_LEN && frames[0][at + flen] == 0x03 && frames[0][at + flen - PUNCH_LEN + 2] == 0xD3;
+        at += flen + 1;
+        punches++;
+    }
+    CHECK(whole && punches == (size_t)count[0] && count[0] > 2000);
+}
+
+// No room in the frame queue: framing waits, nothing is lost
+static void testFrameQueueFull(void) {
+    size_t pos = 0;
+    int n = 0;
+    for (int i=0; i<FRAME_QUEUE_SIZE + 100; i++) {
+        rxq_write(0, punch, PUNCH_LEN);
+    }
+    CHECK(framer_run(0) < (FRAME_QUEUE_SIZE + 100) * PUNCH_LEN);  // queue filled up
+    CHECK(frameq_count(0) == FRAME_QUEUE_SIZE);
+    n += drain(0, &pos);
+    while (rxq_count(0) > 0) {
+        CHECK(framer_run(0) > 0);
+        n += drain(0, &pos);
+    }
+    CHECK(n == FRAME_QUEUE_SIZE + 100 && pos == (size_t)n * (PUNCH_LEN + 1));
+}
+
+// Data without headers goes out in frames of FRAME_MAX
+static void testNoHeader(void) {
+    uint8_t noise[FRAME_MAX * 3];
+    size_t pos = 0;
+    memset(noise, 0x55, sizeof(noise));
+    rxq_write(1, noise, sizeof(noise));
+    framer_run(1);
+    CHECK(drain(1, &pos) == 3 && frames[1][0] == FRAME_MAX && rxq_count(1) == 0);
+}
+
+// A valid frame of len payload bytes: STX D3 len payload CRC1 CRC0 ETX, returns its length
+static size_t makeFrame(uint8_t *f, uint8_t len) {
+    f[0] = 0x02;
+    f[1] = 0xD3;
+    f[2] = len;
+    for (int i=0; i<len; i++) {
+        f[3 + i] = 0x30 + i % 64;
+    }
+    uint16_t crc = sicrc(f + 1, len + 2);
+    f[3 + len] = crc >> 8;
+    f[4 + len] = crc & 0xFF;
+    f[5 + len] = 0x03;
+    return len + 6;
+}
+
+// Valid frames longer and shorter than a punch go as they came, the compact format on
+static void testOtherLength(void) {
+    const uint8_t lens[2] = {40, 4};
+    uint8_t f[FRAME_MAX];
+    framer_stats_t before, after;
+    wire_init(8);
+    for (int k=0; k<2; k++) {
+        size_t n = makeFrame(f, lens[k]), pos = 0;
+        framer_stats(1, &before);
+        rxq_write(1, f, n);
+        framer_run(1);
+        framer_stats(1, &after);
+        CHECK(after.valid == before.valid + 1 && drain(1, &pos) == 1);
+        CHECK(frames[1][0] == n && memcmp(&frames[1][1], f, n) == 0 && rxq_count(1) == 0);
+    }
+    wire_init(0);
+}
+
+// The firmware's core split: reception and framing in one thread, frames taken in another
+static size_t coreStreamLen;
+
+static void *rxCore(void *arg) {
+    size_t fed = 0;
+    (void)arg;
+    while (fed < coreStreamLen || rxq_count(0) > 0) {  // until all is sent
+        if (fed < coreStreamLen) {
+            size_t n = coreStreamLen - fed < 97 ? coreStreamLen - fed : 97;
+            fed += rxq_write(0, stream + fed, n);
+        }
+        if (framer_run(0) == 0) {
+            sched_yield();                          // frame queue full: let the other side run
+        }
+    }
+    return NULL;
+}
+
+static void testTwoCores(void) {
+    pthread_t rx;
+    frame_t frame;
+    ring_span_t data[2];
+    size_t got = 0;
+    bool same = true;
+    coreStreamLen = makeStream(sizeof(stream));
+    pthread_create(&rx, NULL, rxCore, NULL);
+    while (got < coreStreamLen) {
+        if (frameq_read(0, &frame, data)) {
+            same &= got + frame.len <= coreStreamLen &&
+                    memcmp(data[0].data, stream + got, data[0].len) == 0 &&
+                    memcmp(data[1].data, stream + got + data[0].len, data[1].len) == 0;
+            got += frame.len;
+            frameq_release(&frame);
+        } else {
+            sched_yield();
+        }
+    }
+    pthread_join(rx, NULL);
+    CHECK(same && got == coreStreamLen);
+}
+
+// The rx DMA laps bytes not yet framed: framing skips them and goes on with what is left
+static void testLapped(void) {
+    ring_span_t span[2];
+    frameq_stats_t st;
+    size_t pos = 0, n = makeStream(RX_QUEUE_SIZE + 4000);
+    rxq_write_spans(1, span);                           // the DMA writes from the head on
+    size_t head = span[0].data - rxq_storage(1);
+    for (size_t i=0; i<n; i++) {
+        rxq_storage(1)[(head + i) & (RX_QUEUE_SIZE - 1)] = stream[i];
+    }
+    CHECK(rxq_produce_overwriting(1, n) == n - RX_QUEUE_SIZE);
+    int count = 0;
+    while (rxq_count(1) > 0) {
+        framer_run(1);
+        count += drain(1, &pos);
+    }
+    frameq_stats(1, &st);
+    CHECK(st.skipped == n - RX_QUEUE_SIZE && rxq_count(1) == 0);
+    // The last frame is the last punch, whole
+    CHECK(count > 1000 && pos >= PUNCH_LEN + 1 && frames[1][pos - PUNCH_LEN - 1] == PUNCH_LEN);
+    CHECK(memcmp(&frames[1][pos - PUNCH_LEN], stream + n - PUNCH_LEN, PUNCH_LEN) == 0);
+}
+
+int main(void) {
+    testBatchMatchesStep();
+    testFrameQueueFull();
+    testNoHeader();
+    testOtherLength();
+    testTwoCores();
+    testLapped();
+    return CHECK_REPORT("framerTest");
+}
@@ -3,7 +3,7 @@ import time
 import numpy as np
 
 # Documentation: PC programmer's guide and SISRR1AP serial data record
-# Each punch is a byte array of 15 bytes
+# Each punch is a byte array of 19 bytes
 punchPre 	= 0x02 	# STX, constant preamble of punch (only in "new" format?)
 punchHdr 	= 0xD3 	# 211, Constant first byte of every punch
 punchLen 	= 13 			# LEN 1 byte payload length byte, 0Dh = 13 byte constant
@@ -23,7 +23,29 @@ punchTD		= 0				# TD 1 byte day-of-week/half day (in test: real time)
 punchTmr	= 0				# TH...TL 2 bytes 12h timer, binary, seconds within AM/PM
 punchTSS	= 0				# TSS 1 byte sub second values 1/256 sec
 punchMem	= 0				# MEM2...MEM0 3 bytes backup memory start address of the data record (in test: index into punchList)
-punchCRC	= 0xABCD		# CRC1, CRC0 2 bytes 16 bit CRC value, computed including command byte and in test: constant 0
+punchCRC	= 0				# CRC1, CRC0 2 bytes 16 bit CRC value, computed including command byte and length
+punchPost	= 0x03 	# ETX, constant end of punch after an STX
+
+# SportIdent CRC (PC programmer's guide) of the bytes from the command byte to the end of the data
+def siCrc(data):
+	if len(data) < 2:
+		return 0
+	crc = data[0] << 8 | data[1]
+	if len(data) == 2:
+		return crc
+	words = [data[i] << 8 | (data[i+1] if i+1 < len(data) else 0) for i in range(2, len(data), 2)]
+	if len(data) % 2 == 0:
+		words.append(0)
+	for val in words:
+		for bit in range(16):
+			carry = crc & 0x8000
+			crc = (crc << 1) & 0xFFFF
+			if val & 0x8000:
+				crc += 1
+			if carry:
+				crc ^= 0x8005
+			val <<= 1
+	return crc
 
 
 
@@ -62,7 +84,9 @@ def generatePunches(Npunches=1, Nstations=2):
 		punchTSS = 	np.mod((punchTime_ns - midnight_ns)*256/1e9, 256)   # ns fraction 256ths
 		punch.extend(np.int8(punchTSS).tobytes()[::-1]) 
 		punch.extend(np.int32(punchIdx).tobytes()[::-1][1:4]) 	# Index of punch in punchList, 3 bytes
-		punch.extend(np.int16(punchCRC).tobytes()[::-1]) 		#TBD
+		punchCRC = siCrc(punch[1:])
+		punch.extend([punchCRC >> 8, punchCRC & 0xFF])
+		punch.extend([punchPost])
 		# print("Punch " + '{:4d}'.format(punchSN) + " : " +  "    ".join('{:02x}'.format(byte) for byte in punch))
 		punchList.append(punch)
 		# punchSN += 1
@@ -0,0 +1,14 @@
+// Settable clock standing in for the RP2040 timer (timebase.c) in host builds
+
+#include "timebase.h"
+#include "hostTime.h"
+
+uint64_t hostTimeUs = 0;
+
+uint32_t timebase_us(void) {
+    return (uint32_t)hostTimeUs;
+}
+
+uint32_t timebase_ms(void) {
+    return (uint32_t)(hostTimeUs / 1000);
+}
\ No newline at end of file
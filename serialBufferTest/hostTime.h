@@ -0,0 +1,18 @@
+#ifndef HOSTTIME_H
+#define HOSTTIME_H
+
+// Settable clock behind timebase.h in host builds (hostTime.c)
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint64_t hostTimeUs;     // current time [us], advanced by the tests
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
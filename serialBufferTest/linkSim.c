@@ -0,0 +1,115 @@
+// 2023 FIF orientering
+// Throughput model of the radio link rate (RADIO_BAUD) against the inputs (Nchannels=10):
+// BUSY inputs at 38400 baud send punches back to back for BURST_S seconds, a mass start
+// or finish, through the rx queues, framer.c and the arbiter to a radio UART at the rate
+// given. CTS stalls of the modem are not modelled. Prints CSV: offered and sent bytes/s
+// during the burst, the headroom (link rate over offered rate), the largest backlog, the
+// bytes lost to full rx queues and the time to send the backlog after the burst.
+
+#include <stdio.h>
+#include "framer.h"
+#include "arbiter.h"
+#include "hostTime.h"
+
+#define STEP_US 200
+#define BURST_S 10
+#define DRAIN_MAX_S 120
+#define INPUT_BAUD 38400
+#define PUNCH_LEN 19
+
+static const uint8_t punch[PUNCH_LEN] = {0x02, 0xD3, 0x0D, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07,
+                                         0x02, 0x10, 0x20, 0x30, 0x00, 0x00, 0x07, 0x4F, 0x20, 0x03};
+
+static uint32_t dropped(void) {
+    uint32_t n = 0;
+    for (int chan=0; chan<Nchannels; chan++) {
+        ring_stats_t st;
+        rxq_stats(chan, &st);
+        n += st.dropped;
+    }
+    return n;
+}
+
+static size_t waiting(void) {
+    size_t n = 0;
+    for (int chan=0; chan<Nchannels; chan++) {
+        n += frameq_count(chan);
+    }
+    return n;
+}
+
+static size_t backlog(void) {
+    size_t n = 0;
+    for (int chan=0; chan<Nchannels; chan++) {
+        n += rxq_count(chan);
+    }
+    return n;
+}
+
+static void sim(int busy, uint32_t radioBaud) {
+    uint64_t inBits[Nchannels] = {0}, outBits = 0;   // line credit [bit * us / s]
+    int pos[Nchannels] = {0};
+    frame_t frame;
+    ring_span_t data[2];
+    bool onAir = false;
+    size_t left = 0, most = 0;                       // bytes of the frame on air still to send
+    uint64_t sentBurst = 0;
+    uint32_t lostBefore = dropped();
+    long t, burstSteps = BURST_S * 1000000L / STEP_US;
+    arbiter_init(ARB_ROUND_ROBIN);
+    bool sending = true;
+    for (t=0; sending || waiting() > 0 || onAir; t++) {
+        if (t >= burstSteps + DRAIN_MAX_S * 1000000L / STEP_US) {
+            break;
+        }
+        hostTimeUs += STEP_US;
+        sending = false;
+        for (int chan=0; chan<busy; chan++) {       // Whole punches, the last one finished
+            if (t >= burstSteps && pos[chan] == 0) {
+                continue;
+            }
+            for (inBits[chan] += (uint64_t)INPUT_BAUD * STEP_US; inBits[chan] >= 10000000; inBits[chan] -= 10000000) {
+                rxq_put(chan, punch[pos[chan]]);
+                pos[chan] = (pos[chan] + 1) % PUNCH_LEN;
+            }
+            sending = true;
+        }
+        size_t framed = 0;
+        for (int chan=0; chan<Nchannels; chan++) {
+            framed += framer_run(chan);
+        }
+        sending |= framed > 0;
+        for (outBits += (uint64_t)radioBaud * STEP_US; outBits >= 10000000; outBits -= 10000000) {
+            if (!onAir) {
+                onAir = arbiter_next(&frame, data);
+                left = onAir ? frame.len : 0;
+            }
+            if (!onAir) {
+                outBits = 0;                        // Idle line: no credit saved up
+                break;
+            }
+            sentBurst += t < burstSteps;
+            if (--left == 0) {
+                frameq_release(&frame);
+                onAir = false;
+            }
+        }
+        most = backlog() > most ? backlog() : most;
+    }
+    double offered = busy * INPUT_BAUD / 10.0;
+    printf("%lu,%d,%.0f,%.0f,%.2f,%zu,%lu,%.1f\n", (unsigned long)radioBaud, busy, offered,
+           sentBurst / (double)BURST_S, radioBaud / 10.0 / offered, most,
+           (unsigned long)(dropped() - lostBefore), (t - burstSteps) * STEP_US / 1e6);
+}
+
+int main(void) {
+    const uint32_t radio[] = {38400, 57600, 115200};
+    const int busy[] = {1, 2, 4, 8};
+    printf("radio_baud,busy_inputs,offered_Bps,sent_Bps,headroom,max_backlog_bytes,lost_bytes,drain_s\n");
+    for (unsigned r=0; r<sizeof(radio) / sizeof(radio[0]); r++) {
+        for (unsigned b=0; b<sizeof(busy) / sizeof(busy[0]); b++) {
+            sim(busy[b], radio[r]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+// 2023 FIF orientering
+// Host test of the link telemetry (link.c): a modem taking MODEM_PACKET bytes per CTS clear
+// window and holding CTS for CYCLE_US after each, fed more than it takes by one channel.
+// The bytes per window, the drain rate, the input rate and the time until channel 0's
+// queues overflow (its frame queue, with punches) must come out as the model gives them; a
+// quiet link forecasts nothing.
+
+#include "link.h"
+#include "cts.h"
+#include "txeng.h"
+#include "pack.h"
+#include "arbiter.h"
+#include "hostTime.h"
+#include "check.h"
+#include "punch.h"
+
+#define CHAR_US 260
+#define MODEM_PACKET 114        // six punches
+#define CYCLE_US 250000
+#define PUNCH_US 32000          // 594 bytes/s in
+
+static size_t remaining;
+static struct {
+    bool held;
+    uint64_t clearUs;           // when CTS comes back
+    size_t taken;               // bytes in the modem's packet
+} modem;
+
+static void simStart(const uint8_t *data, size_t len) {
+    (void)data;
+    remaining = len;
+}
+
+static const txeng_port_t simPort = {simStart};
+
+static void tick(uint64_t *nextPunchUs) {
+    uint8_t p[PUNCH_LEN];
+    frame_t frame;
+    ring_span_t data[2];
+    hostTimeUs += CHAR_US;
+    if (nextPunchUs && hostTimeUs >= *nextPunchUs) {
+        punch_make(p, 1, (uint32_t)hostTimeUs, 0, 0, 0);
+        if (fq_space(0) > 0 && rxq_write(0, p, PUNCH_LEN) == PUNCH_LEN) {
+            frameq_commit(0, PUNCH_LEN, (uint32_t)hostTimeUs);
+        }
+        *nextPunchUs += PUNCH_US;
+    }
+    if (modem.held && hostTimeUs >= modem.clearUs) {
+        modem.held = false;
+        cts_edge(true, (uint32_t)hostTimeUs);
+    }
+    if (!modem.held && remaining > 0) {                 // A byte over the line
+        if (--remaining == 0) {
+            txeng_irq();
+        }
+        if (++modem.taken == MODEM_PACKET) {            // Packet full: send it
+            modem.taken = 0;
+            modem.held = true;
+            modem.clearUs = hostTimeUs + CYCLE_US;
+            cts_edge(false, (uint32_t)hostTimeUs);
+        }
+    }
+    while (txeng_ready() && pack_next(&frame, data)) {
+        txeng_submit(&frame, data);
+    }
+    link_poll((uint32_t)hostTimeUs);
+}
+
+static void testOverload(void) {
+    link_stats_t st;
+    uint64_t nextPunchUs = hostTimeUs;
+    for (long t=0; t<15000000L / CHAR_US; t++) {        // 15 s, the frame queue over half full
+        tick(&nextPunchUs);
+    }
+    link_stats(&st);
+    double drain = MODEM_PACKET * 1e6 / (MODEM_PACKET * CHAR_US + CYCLE_US);
+    double in = PUNCH_LEN * 1e6 / PUNCH_US, grow = in - drain;
+    double fullIn = (FRAME_QUEUE_SIZE - frameq_count(0)) * PUNCH_LEN / grow;
+    CHECK(st.windows > 40 && st.windowBytes >= MODEM_PACKET - PUNCH_LEN && st.windowBytes <= MODEM_PACKET + PUNCH_LEN);
+    CHECK(st.drainBps > drain * 0.9 && st.drainBps < drain * 1.1);
+    CHECK(st.sentBps > drain * 0.9 && st.sentBps < drain * 1.1);
+    CHECK(st.inBps > in * 0.95 && st.inBps < in * 1.05);
+    CHECK(st.growBps[0] > grow * 0.9 && st.growBps[0] < grow * 1.1 && st.growBps[1] == 0);
+    CHECK(st.growFpm[0] > grow * 60 / PUNCH_LEN * 0.9 && st.growFpm[0] < grow * 60 / PUNCH_LEN * 1.1);
+    CHECK(st.fullChan == 0 && st.fullInS > fullIn * 0.85 && st.fullInS < fullIn * 1.15);
+    printf("linkTest: drain %lu B/s (model %.0f), in %lu B/s, %lu B per window, queues full in %lu s (model %.0f)\n",
+           (unsigned long)st.drainBps, drain, (unsigned long)st.inBps, (unsigned long)st.windowBytes,
+           (unsigned long)st.fullInS, fullIn);
+}
+
+// The input stops: the backlog drains, the queue shrinks, nothing is forecast
+static void testQuiet(void) {
+    link_stats_t st;
+    for (long t=0; t<120000000L / CHAR_US; t++) {       // 2 min
+        tick(NULL);
+    }
+    link_stats(&st);
+    CHECK(rxq_count(0) == 0 && st.fullChan == -1 && st.inBps == 0);
+    CHECK(st.drainBps > 0);                             // the last loaded estimate kept
+}
+
+int main(void) {
+    txeng_init(&simPort);
+    arbiter_init(ARB_ROUND_ROBIN);
+    cts_init(true, true, (uint32_t)hostTimeUs);
+    pack_init(0, 0, 0, false);
+    link_init((uint32_t)hostTimeUs);
+    testOverload();
+    testQuiet();
+    return CHECK_REPORT("linkTest");
+}
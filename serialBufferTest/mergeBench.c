@@ -0,0 +1,105 @@
+// 2023 FIF orientering
+// Host benchmark of the transmit order (arbiter.c): punches from a busy station on channel 0
+// and a backlogged one on channel 1, which delivers its punches up to BACKLOG_MS late.
+// For each policy: CPU ns per punch picked by the arbiter, punches sent out of punch time order,
+// and the wait from arrival until sent (what the punch time merge adds to the latency).
+// Simulated time, 1 ms ticks; the radio takes a frame every FRAME_MS. Prints CSV.
+
+#include <stdio.h>
+#include <time.h>
+#include "arbiter.h"
+#include "framer.h"
+#include "hostTime.h"
+
+#define PUNCHES 20000
+#define PUNCH_LEN 18
+#define GAP_MS {20, 60}         // mean time between punches per channel
+#define BACKLOG_MS 400          // channel 1 delivers a punch 0 to this late
+#define FRAME_MS 4
+
+static uint32_t seed = 12345;
+static uint32_t rnd(uint32_t range) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) % range;
+}
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void publish(int chan, uint64_t punchedMs) {
+    uint32_t time = (uint32_t)(punchedMs * 256 / 1000 % PUNCH_TIME_CYCLE);
+    uint32_t halfDays = time / (43200 * 256), seconds = time / 256 % 43200;
+    uint8_t td = (halfDays / 14) << 4 | (halfDays % 14 / 2) << 1 | (halfDays & 1);
+    uint8_t punch[PUNCH_LEN] = {0x02, 0xD3, 0x0D, 0x00, chan, 0x00, 0x00, 0x00, 0x07,
+                                td, seconds >> 8, seconds & 0xFF, time & 0xFF, 0x00, 0x00, 0x07, 0xAB, 0xCD};
+    rxq_write(chan, punch, PUNCH_LEN);
+    frameq_commit(chan, PUNCH_LEN, (uint32_t)hostTimeUs);
+}
+
+static void bench(const char *name, arb_policy_t policy) {
+    const uint32_t gapMs[Nchannels] = GAP_MS;
+    uint64_t punched[Nchannels] = {0}, arrives[Nchannels] = {0};
+    int published = 0, sent = 0, outOfOrder = 0;
+    uint32_t latest = 0;
+    uint64_t ns = 0;
+    bool any = false;
+    frame_t frame;
+    ring_span_t data[2];
+
+    seed = 12345;
+    hostTimeUs = 0;
+    arbiter_init(policy);
+    for (int chan=0; chan<Nchannels; chan++) {
+        punched[chan] = arrives[chan] = rnd(2 * gapMs[chan]);
+    }
+    for (uint64_t ms=0; sent<published || published<PUNCHES; ms++) {
+        hostTimeUs = ms * 1000;
+        for (int chan=0; chan<Nchannels; chan++) {
+            while (published < PUNCHES && arrives[chan] <= ms) {
+                publish(chan, punched[chan]);
+                published++;
+                punched[chan] += 1 + rnd(2 * gapMs[chan]);
+                uint64_t late = chan == 1 ? rnd(BACKLOG_MS) : 0;
+                arrives[chan] = punched[chan] + late > arrives[chan] ? punched[chan] + late : arrives[chan];
+            }
+        }
+        if (ms % FRAME_MS) {
+            continue;
+        }
+        uint64_t start = nowNs();
+        if (arbiter_next(&frame, data)) {
+            ns += nowNs() - start;          // The decisions, not the polls finding nothing
+            uint32_t time;
+            framer_punch_time(data, frame.len, &time);
+            if (any && framer_punch_time_diff(time, latest) < 0) {
+                outOfOrder++;
+            } else {
+                latest = time;
+            }
+            any = true;
+            frameq_release(&frame);
+            sent++;
+        }
+    }
+    uint64_t waits = 0;
+    uint32_t maxWait = 0;
+    for (int chan=0; chan<Nchannels; chan++) {
+        arbiter_stats_t st;
+        arbiter_stats(chan, &st);
+        waits += st.sumWaitUs;
+        maxWait = st.maxWaitUs > maxWait ? st.maxWaitUs : maxWait;
+    }
+    printf("%s,%d,%.1f,%d,%.0f,%lu\n", name, sent, (double)ns / sent, outOfOrder,
+           (double)waits / sent, (unsigned long)maxWait);
+}
+
+int main(void) {
+    printf("policy,punches,ns_per_punch,out_of_order,mean_wait_us,max_wait_us\n");
+    bench("round_robin", ARB_ROUND_ROBIN);
+    bench("oldest_first", ARB_OLDEST_FIRST);
+    bench("punch_time", ARB_PUNCH_TIME);
+    return 0;
+}
@@ -0,0 +1,172 @@
+// 2023 FIF orientering
+// Throughput model of the radio packets (pack.c) against a TinyMesh modem: the modem sends
+// a packet when it holds MODEM_PACKET bytes or the line has been quiet MODEM_TIMEOUT_US,
+// then holds CTS low for the packet cycle. Punches arrive at random on four channels at the
+// offered rate, through the arbiter, packing (or not) and the transmit engine to a UART
+// with a 32 char TX FIFO at 38400 baud. Packing is off, on with the fixed flush window, or
+// adaptive, the window following the modem's CTS (cts.c). Prints CSV per mode, packet cycle and
+// offered rate: punches delivered per second, and of them not split across two packets,
+// radio packets and punches per packet, punches split, and the latency from frame arrival
+// to the end of its packet.
+
+#include <stdio.h>
+#include <string.h>
+#include "pack.h"
+#include "arbiter.h"
+#include "txeng.h"
+#include "cts.h"
+#include "hostTime.h"
+#include "punch.h"
+
+#define CHAR_US 260             // one step, a character at 38400 baud
+#define RUN_S 60
+#define MODEM_PACKET 120
+#define MODEM_TIMEOUT_US 2000
+#define TX_FIFO_DEPTH 32
+#define INPUTS 2
+
+static uint32_t seed;
+static uint32_t rnd(uint32_t range) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) % range;
+}
+
+static struct {
+    const uint8_t *data;        // DMA
+    size_t remaining;
+    int fifo;                   // bytes in the UART TX FIFO
+    bool cts;
+    uint64_t ctsUs;             // CTS back up
+    size_t modem;               // bytes in the modem's packet buffer
+    uint64_t lastByteUs;
+    uint64_t lineBytes;         // bytes over the line so far
+    uint64_t submitted;         // bytes given to the engine so far
+} sim;
+
+static struct {                 // frames submitted, not yet delivered, in line order
+    uint64_t end;               // line byte count after the frame
+    uint32_t arrival;
+} sentFrames[4096];
+static int sentHead, sentTail;
+
+static struct {
+    uint32_t delivered, packets, split;
+    uint64_t sumLatencyUs, maxLatencyUs;
+} res;
+
+static void simStart(const uint8_t *data, size_t len) {
+    sim.data = data;
+    sim.remaining = len;
+}
+
+static const txeng_port_t simPort = {simStart};
+
+// The modem closes a packet: the frames ending in it are delivered
+static void modemSend(uint32_t cycleMs) {
+    res.packets++;
+    while (sentHead != sentTail && sentFrames[sentHead % 4096].end <= sim.lineBytes) {
+        uint64_t latency = hostTimeUs - sentFrames[sentHead % 4096].arrival;
+        res.sumLatencyUs += latency;
+        res.maxLatencyUs = latency > res.maxLatencyUs ? latency : res.maxLatencyUs;
+        res.delivered++;
+        sentHead++;
+    }
+    res.split += sentHead != sentTail && sentFrames[sentHead % 4096].end - sim.lineBytes < PUNCH_LEN;
+    sim.modem = 0;
+    sim.cts = false;
+    cts_edge(false, (uint32_t)hostTimeUs);
+    sim.ctsUs = hostTimeUs + cycleMs * 1000;
+}
+
+static void lineStep(uint32_t cycleMs) {
+    while (sim.remaining > 0 && sim.fifo < TX_FIFO_DEPTH) {
+        sim.fifo++;
+        sim.remaining--;
+        if (sim.remaining == 0) {
+            txeng_irq();
+        }
+    }
+    if (!sim.cts && hostTimeUs >= sim.ctsUs) {
+        sim.cts = true;
+        cts_edge(true, (uint32_t)hostTimeUs);
+    }
+    if (sim.cts && sim.fifo > 0) {
+        sim.fifo--;
+        sim.modem++;
+        sim.lineBytes++;
+        sim.lastByteUs = hostTimeUs;
+        if (sim.modem == MODEM_PACKET) {
+            modemSend(cycleMs);
+        }
+    } else if (sim.modem > 0 && hostTimeUs - sim.lastByteUs >= MODEM_TIMEOUT_US) {
+        modemSend(cycleMs);
+    }
+}
+
+static bool busy(void) {
+    for (int chan=0; chan<INPUTS; chan++) {
+        if (frameq_count(chan) > 0) {
+            return true;
+        }
+    }
+    return !txeng_idle() || pack_due_us() != UINT32_MAX || sentHead != sentTail || sim.modem > 0 || !sim.cts;
+}
+
+static void sim1(const char *mode, uint32_t packetMax, bool adaptive, uint32_t cycleMs, double offered) {
+    uint8_t p[PUNCH_LEN];
+    frame_t frame;
+    ring_span_t data[2];
+    pack_stats_t st;
+    memset(&sim, 0, sizeof(sim));
+    memset(&res, 0, sizeof(res));
+    sim.cts = true;
+    sentHead = sentTail = 0;
+    seed = 12345;
+    hostTimeUs = 0;
+    arbiter_init(ARB_ROUND_ROBIN);
+    cts_init(true, true, 0);
+    pack_init(packetMax, PACKET_FLUSH_MS * 1000u, PACKET_GAP_MS * 1000u, adaptive);
+    uint32_t perStep = (uint32_t)(offered * CHAR_US / 1e6 * 1e6);    // chance per step [1e-6]
+    long steps = RUN_S * 1000000L / CHAR_US;
+    uint32_t inRun = 0, splitInRun = 0;
+    for (long t=0; t<steps || busy(); t++) {                        // Then send the rest
+        hostTimeUs += CHAR_US;
+        inRun = t < steps ? res.delivered : inRun;
+        splitInRun = t < steps ? res.split : splitInRun;
+        if (t < steps && rnd(1000000) < perStep) {
+            int chan = rnd(INPUTS);
+            punch_make(p, chan, (uint32_t)t, 0, 0, 0);
+            if (fq_space(chan) > 0 && rxq_write(chan, p, PUNCH_LEN) == PUNCH_LEN) {
+                frameq_commit(chan, PUNCH_LEN, (uint32_t)hostTimeUs);
+            }
+        }
+        while (txeng_ready() && pack_next(&frame, data)) {
+            sim.submitted += frame.len;
+            sentFrames[sentTail % 4096].end = sim.submitted;
+            sentFrames[sentTail % 4096].arrival = frame.arrival;
+            sentTail++;
+            txeng_submit(&frame, data);
+        }
+        lineStep(cycleMs);
+    }
+    pack_stats(&st);
+    printf("%s,%lu,%.0f,%.1f,%.1f,%lu,%.2f,%lu,%.0f,%.0f\n", mode, (unsigned long)cycleMs, offered,
+           inRun / (double)RUN_S, (inRun - splitInRun) / (double)RUN_S, (unsigned long)res.packets,
+           res.packets ? (double)res.delivered / res.packets : 0, (unsigned long)res.split,
+           res.delivered ? res.sumLatencyUs / 1000.0 / res.delivered : 0, res.maxLatencyUs / 1000.0);
+}
+
+int main(void) {
+    const uint32_t cycles[] = {50, 250};
+    const double offered[] = {2, 5, 10, 20, 40};            // punches/s, all inputs
+    txeng_init(&simPort);
+    printf("packing,cycle_ms,offered_pps,delivered_pps,intact_pps,packets,punches_per_packet,split,mean_latency_ms,max_latency_ms\n");
+    for (unsigned c=0; c<sizeof(cycles) / sizeof(cycles[0]); c++) {
+        for (unsigned o=0; o<sizeof(offered) / sizeof(offered[0]); o++) {
+            sim1("off", 0, false, cycles[c], offered[o]);
+            sim1("on", PACKET_MAX, false, cycles[c], offered[o]);
+            sim1("adaptive", PACKET_MAX, true, cycles[c], offered[o]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,211 @@
+// 2023 FIF orientering
+// Host tests of the radio packets (pack.c): whole frames grouped up to the packet size,
+// the flush timer, the quiet gap between packets, frames longer than a packet, packing off,
+// and the window adapting to the modem's CTS (cts.c). The frames go through the arbiter and
+// the transmit engine; the simulated DMA hands one byte per character time to the line,
+// none while CTS is held.
+
+#include "pack.h"
+#include "arbiter.h"
+#include "txeng.h"
+#include "cts.h"
+#include "hostTime.h"
+#include "check.h"
+
+#define CHAR_US 260
+#define PUNCH_LEN 19
+#define MAX 120
+#define FLUSH_US 20000
+#define GAP_US 12000
+
+static size_t remaining;        // bytes of the DMA transfer
+static bool ctsHeld;
+
+static void simStart(const uint8_t *data, size_t len) {
+    (void)data;
+    remaining = len;
+}
+
+static const txeng_port_t simPort = {simStart};
+
+static void publish(int chan, size_t len) {
+    for (size_t i=0; i<len; i++) {
+        rxq_put(chan, (uint8_t)i);
+    }
+    frameq_commit(chan, len, (uint32_t)hostTimeUs);
+}
+
+static struct {
+    int packets;
+    int frames[64];             // per packet
+    size_t bytes[64];
+    uint64_t startUs[64];       // handed over
+    uint64_t idleUs[64];        // all in the UART
+} seen;
+
+// One character time of the main loop and the line: a packet is what one pass hands over
+static void tick(void) {
+    frame_t frame;
+    ring_span_t data[2];
+    bool first = true;
+    while (txeng_ready() && pack_next(&frame, data)) {
+        if (first) {
+            seen.startUs[seen.packets] = hostTimeUs;
+            seen.frames[seen.packets] = 0;
+            seen.bytes[seen.packets] = 0;
+            seen.packets++;
+            first = false;
+        }
+        seen.frames[seen.packets - 1]++;
+        seen.bytes[seen.packets - 1] += frame.len;
+        txeng_submit(&frame, data);
+    }
+    hostTimeUs += CHAR_US;
+    if (remaining > 0 && !ctsHeld) {
+        if (--remaining == 0) {
+            txeng_irq();
+            if (txeng_idle()) {
+                seen.idleUs[seen.packets - 1] = hostTimeUs;
+            }
+        }
+    }
+}
+
+static void run(int ticks) {
+    for (int t=0; t<ticks; t++) {
+        tick();
+    }
+}
+
+static void start(uint32_t max, bool adaptive) {
+    seen.packets = 0;
+    arbiter_init(ARB_ROUND_ROBIN);
+    pack_init(max, FLUSH_US, GAP_US, adaptive);
+}
+
+// A backlog of punches on two channels: six to a packet, the last ones flushed, a quiet gap
+// before each packet
+static void testFill(void) {
+    pack_stats_t st;
+    start(MAX, false);
+    for (int i=0; i<20; i++) {
+        publish(i % 2, PUNCH_LEN);
+    }
+    run(2000);
+    CHECK(seen.packets == 4);
+    bool whole = true, gaps = true;
+    for (int p=0; p<seen.packets; p++) {
+        whole &= seen.bytes[p] == (size_t)seen.frames[p] * PUNCH_LEN && seen.bytes[p] <= MAX;
+        whole &= seen.frames[p] == (p < 3 ? 6 : 2);
+        if (p > 0) {
+            gaps &= seen.startUs[p] - seen.idleUs[p - 1] >= GAP_US;
+        }
+    }
+    CHECK(whole && gaps);
+    pack_stats(&st);
+    CHECK(st.packets == 4 && st.frames == 20 && st.bytes == 20 * PUNCH_LEN && st.flushed == 1);
+    CHECK(txeng_idle() && pack_due_us() == UINT32_MAX);
+}
+
+// A single punch waits for others up to the flush time, no longer
+static void testFlush(void) {
+    start(MAX, false);
+    run(100);                                           // the line long quiet
+    publish(0, PUNCH_LEN);
+    tick();
+    CHECK(seen.packets == 0 && pack_due_us() > FLUSH_US - 2 * CHAR_US && pack_due_us() <= FLUSH_US);
+    uint64_t published = hostTimeUs - CHAR_US;
+    run(FLUSH_US / CHAR_US + 2);
+    CHECK(seen.packets == 1 && seen.frames[0] == 1);
+    CHECK(seen.startUs[0] - published >= FLUSH_US && seen.startUs[0] - published <= FLUSH_US + 2 * CHAR_US);
+    run(100);
+}
+
+// A frame longer than a packet goes alone; the one after it in the next packet
+static void testLong(void) {
+    start(MAX, false);
+    run(100);
+    publish(0, FRAME_MAX);
+    publish(0, PUNCH_LEN);
+    run(2000);
+    CHECK(seen.packets == 2 && seen.frames[0] == 1 && seen.bytes[0] == FRAME_MAX);
+    CHECK(seen.frames[1] == 1 && seen.bytes[1] == PUNCH_LEN);
+}
+
+// Off: each frame as soon as the engine has room
+static void testOff(void) {
+    start(0, false);
+    for (int i=0; i<4; i++) {
+        publish(1, PUNCH_LEN);
+    }
+    tick();
+    CHECK(seen.packets == 1 && seen.frames[0] == 4);           // all queued in the engine at once
+    CHECK(pack_due_us() == UINT32_MAX);
+    run(200);
+    CHECK(txeng_idle() && frameq_count(1) == 0);
+}
+
+// The modem holds CTS for a packet cycle
+static void hold(uint32_t us) {
+    cts_edge(false, (uint32_t)hostTimeUs);
+    ctsHeld = true;
+    run(us / CHAR_US);
+    cts_edge(true, (uint32_t)hostTimeUs);
+    ctsHeld = false;
+}
+
+// Idle link: a lone punch at once. While CTS is held the punches gather, to go in one packet
+// when it comes back. Just after a cycle a punch waits a quarter of it; after a clear cycle
+// none.
+static void testAdaptive(void) {
+    const uint32_t cycleUs = 40000;
+    pack_stats_t st;
+    cts_stats_t cs;
+    cts_init(true, true, (uint32_t)hostTimeUs);
+    start(MAX, true);
+    run(100);
+    publish(0, PUNCH_LEN);
+    tick();
+    CHECK(seen.packets == 1 && seen.frames[0] == 1);
+    run(100);
+    cts_edge(false, (uint32_t)hostTimeUs);
+    ctsHeld = true;
+    for (int i=0; i<5; i++) {
+        publish(i % 2, PUNCH_LEN);
+        run(cycleUs / CHAR_US / 5);
+        CHECK(seen.packets == 1 && pack_due_us() == UINT32_MAX);
+    }
+    cts_edge(true, (uint32_t)hostTimeUs);
+    ctsHeld = false;
+    tick();
+    CHECK(seen.packets == 2 && seen.frames[1] == 5);
+    cts_stats(&cs);
+    CHECK(cs.holds == 1 && cs.meanHoldUs > cycleUs * 9 / 10 && cs.meanHoldUs <= cycleUs);
+    run(100);                                           // the burst on the line
+    hold(cycleUs);                                      // its packet cycle
+    publish(1, PUNCH_LEN);
+    tick();
+    CHECK(seen.packets == 2 && pack_due_us() <= cycleUs / 4);
+    run(cycleUs / 4 / CHAR_US + 1);
+    CHECK(seen.packets == 3);
+    run(200);
+    hold(cycleUs);
+    run(cycleUs / CHAR_US + 1);                         // clear a cycle: idle again
+    publish(0, PUNCH_LEN);
+    tick();
+    CHECK(seen.packets == 4);
+    pack_stats(&st);
+    CHECK(st.ctsHeld == 1 && st.windowUs == 0);
+    run(200);
+    cts_init(false, true, 0);
+}
+
+int main(void) {
+    txeng_init(&simPort);
+    testFill();
+    testFlush();
+    testLong();
+    testOff();
+    testAdaptive();
+    return CHECK_REPORT("packTest");
+}
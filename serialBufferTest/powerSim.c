@@ -0,0 +1,102 @@
+// 2023 FIF orientering
+// Host simulation of the firmware's event timing, comparing the polled loops (SLEEP_IDLE 0)
+// with sleeping until the next event (SLEEP_IDLE 1): supply current, core load and the
+// latency from a punch's last byte on the SRR line to its hand-over to the transmit engine.
+// Punches arrive at random (Poisson) on each channel; every punch takes the RX level and
+// RX timeout interrupts, the framing on core1, the hand-over on core0 and the transmit
+// DMA completion interrupt. The costs and currents below are estimates; replace them with
+// measurements from a real buffer to get absolute numbers. Prints CSV:
+// mode,punches_per_s,mean_ma,battery_h,core0_busy_pct,core1_busy_pct,lat_p50_us,lat_p99_us,lat_max_us
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define Nchannels 2
+#define SIM_SECONDS 3600
+#define CHAR_US 260.0           // 10 bits at 38400 baud
+#define PUNCH_CHARS 19
+#define RX_TIMEOUT_US (32 * CHAR_US / 10)   // 32 bit times after the last char
+#define BATTERY_MAH 2000.0
+
+// Current [mA]: always on (regulator, clocks, peripherals), per core running, per core in WFE
+#define BASE_MA 6.0
+#define CORE_ACTIVE_MA 8.0
+#define CORE_SLEEP_MA 0.8
+
+// CPU time [us]
+#define IRQ_US 3.0              // UART RX interrupt entry and exit
+#define IRQ_BYTE_US 0.2         // per char drained
+#define FRAMING_US 5.0          // framer_run for a punch
+#define SUBMIT_US 4.0           // frameq_read and txeng_submit
+#define TX_IRQ_US 2.0           // transmit DMA completion
+#define PASS_US 1.0             // an idle loop pass
+#define WAKE_US 1.0             // WFE to running
+
+static double uniform(void) {
+    return (rand() + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void simulate(int sleeping, double rate) {
+    size_t cap = (size_t)(rate * Nchannels * SIM_SECONDS * 1.5) + 16;
+    double *end = malloc(cap * sizeof(double));       // last char of each punch [us]
+    double *latency = malloc(cap * sizeof(double));
+    size_t n = 0;
+    srand(1);
+    for (int chan=0; chan<Nchannels; chan++) {
+        double t = 0;
+        while (n < cap) {
+            t += -log1p(-uniform()) / rate * 1e6;       // next punch on this channel
+            if (t >= SIM_SECONDS * 1e6) {
+                break;
+            }
+            end[n++] = t;
+        }
+    }
+    qsort(end, n, sizeof(double), compare);
+
+    // Each core serves its work in order; a core busy with one punch delays the next
+    double free0 = 0, free1 = 0, busy0 = 0, busy1 = 0;
+    double wake = sleeping ? WAKE_US : 0;
+    for (size_t i=0; i<n; i++) {
+        // RX level interrupt after 16 chars
+        double level = end[i] - (PUNCH_CHARS - 16) * CHAR_US;
+        double irq = 2 * IRQ_US + PUNCH_CHARS * IRQ_BYTE_US;
+        free1 = (level > free1 ? level : free1) + wake + IRQ_US + 16 * IRQ_BYTE_US;
+        // RX timeout interrupt for the rest, then framing on the next pass
+        double timeout = end[i] + RX_TIMEOUT_US;
+        free1 = (timeout > free1 ? timeout : free1) + wake + IRQ_US + (PUNCH_CHARS - 16) * IRQ_BYTE_US;
+        free1 += (sleeping ? 0 : uniform() * PASS_US) + FRAMING_US;
+        // Core0 takes the frame on its next pass, or when woken by core1's event
+        double ready = free1 + (sleeping ? WAKE_US : uniform() * PASS_US);
+        free0 = (ready > free0 ? ready : free0) + SUBMIT_US;
+        latency[i] = free0 - end[i];
+        free0 += wake + TX_IRQ_US;                      // DMA completion, soon after
+        busy1 += irq + FRAMING_US + 2 * wake;
+        busy0 += SUBMIT_US + TX_IRQ_US + 2 * wake;
+    }
+    double duty0 = sleeping ? busy0 / (SIM_SECONDS * 1e6) : 1.0;
+    double duty1 = sleeping ? busy1 / (SIM_SECONDS * 1e6) : 1.0;
+    double ma = BASE_MA + (duty0 + duty1) * CORE_ACTIVE_MA + (2 - duty0 - duty1) * CORE_SLEEP_MA * sleeping;
+    qsort(latency, n, sizeof(double), compare);
+    printf("%s,%.2f,%.2f,%.0f,%.3f,%.3f,%.1f,%.1f,%.1f\n", sleeping ? "sleep" : "polled", rate * Nchannels,
+           ma, BATTERY_MAH / ma, 100 * duty0, 100 * duty1,
+           n ? latency[n / 2] : 0, n ? latency[n * 99 / 100] : 0, n ? latency[n - 1] : 0);
+    free(end);
+    free(latency);
+}
+
+int main(void) {
+    static const double rates[] = {0.01, 0.1, 1, 10, 50};     // punches/s per channel
+    printf("mode,punches_per_s,mean_ma,battery_h,core0_busy_pct,core1_busy_pct,lat_p50_us,lat_p99_us,lat_max_us\n");
+    for (size_t i=0; i<sizeof(rates)/sizeof(rates[0]); i++) {
+        simulate(0, rates[i]);
+        simulate(1, rates[i]);
+    }
+    return 0;
+}
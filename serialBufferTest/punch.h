@@ -0,0 +1,77 @@
+#ifndef PUNCH_H
+#define PUNCH_H
+
+// Punch records for the host tests: STX D3 0D CN1 CN0 SN3..SN0 TD TH TL TSS MEM2..MEM0 CRC1 CRC0 ETX,
+// with the CRC of sicrc.h. The bitwise CRC of the PC programmer's guide to check it against.
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sicrc.h"
+
+#define PUNCH_LEN 19
+
+// The CRC of the guide, bit by bit over 16 bit words
+static inline uint16_t punch_crc_bitwise(const uint8_t *data, size_t count) {
+    if (count < 2) {
+        return 0;
+    }
+    uint16_t crc = data[0] << 8 | data[1];
+    if (count == 2) {
+        return crc;
+    }
+    data += 2;
+    for (size_t i=count / 2; i>0; i--) {
+        uint16_t val = 0;
+        if (i > 1) {
+            val = data[0] << 8 | data[1];
+            data += 2;
+        } else if (count & 1) {
+            val = data[0] << 8;
+        }
+        for (int bit=0; bit<16; bit++) {
+            if (crc & 0x8000) {
+                crc <<= 1;
+                if (val & 0x8000) {
+                    crc++;
+                }
+                crc ^= 0x8005;
+            } else {
+                crc <<= 1;
+                if (val & 0x8000) {
+                    crc++;
+                }
+            }
+            val <<= 1;
+        }
+    }
+    return crc;
+}
+
+// Set the CRC of a punch record after changing its fields
+static inline void punch_seal(uint8_t p[PUNCH_LEN]) {
+    uint16_t crc = sicrc(p + 1, PUNCH_LEN - 4);
+    p[PUNCH_LEN - 3] = crc >> 8;
+    p[PUNCH_LEN - 2] = crc & 0xFF;
+}
+
+// A punch of station, card and time fields as they go on the line
+static inline void punch_make(uint8_t p[PUNCH_LEN], uint16_t station, uint32_t card,
+                              uint8_t td, uint16_t seconds, uint8_t tss) {
+    const uint8_t fields[PUNCH_LEN] = {0x02, 0xD3, 0x0D, station >> 8, station & 0xFF,
+                                       card >> 24, card >> 16, card >> 8, card, td, seconds >> 8,
+                                       seconds & 0xFF, tss, 0x00, 0x00, 0x07, 0x00, 0x00, 0x03};
+    for (int i=0; i<PUNCH_LEN; i++) {
+        p[i] = fields[i];
+    }
+    punch_seal(p);
+}
+
+// Set the backup memory address of a punch record
+static inline void punch_mem(uint8_t p[PUNCH_LEN], uint32_t mem) {
+    p[13] = mem >> 16;
+    p[14] = mem >> 8;
+    p[15] = mem;
+    punch_seal(p);
+}
+
+#endif
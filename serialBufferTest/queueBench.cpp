@@ -0,0 +1,226 @@
+// 2023 FIF orientering
+// Host benchmark and contention suite for the queue implementations:
+// the fifo.c queue (runtime size, % wrap) and RingBuffer<uint8_t, N> (power of two, mask wrap).
+//  - Single thread ns/byte for put, get, peek and bulk (18 byte punch) write/read.
+//  - Two threads: producer/consumer throughput and latency percentiles per capacity.
+// Results are printed as CSV (default) or JSON (--json), one row per measurement, so
+// implementations can be compared before they go to the Pico.
+// Note: a host CPU divides in hardware, so the % cost understates the Cortex-M0+,
+// where every % is a call to a software divide routine.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "fifo.h"
+#include "ringbuffer.hpp"
+
+static const size_t totalBytes = 4u << 20;  // per single thread measurement
+static const size_t burst = 512;            // bytes written, then read, per round
+static volatile uint32_t sink;
+static bool json = false;
+static int rows = 0;
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+struct result {
+    const char *impl;
+    const char *test;
+    size_t capacity;
+    int threads;
+    double nsPerByte;
+    double p50, p90, p99, max;      // latency [ns], two thread tests only
+};
+
+static void emit(const result &r) {
+    double mbs = 1e3 / r.nsPerByte;
+    if (json) {
+        printf("%s\n  {\"impl\": \"%s\", \"test\": \"%s\", \"capacity\": %zu, \"threads\": %d, "
+               "\"ns_per_byte\": %.3f, \"mb_per_s\": %.1f, \"lat_p50_ns\": %.0f, \"lat_p90_ns\": %.0f, "
+               "\"lat_p99_ns\": %.0f, \"lat_max_ns\": %.0f}",
+               rows ? "," : "[", r.impl, r.test, r.capacity, r.threads, r.nsPerByte, mbs, r.p50, r.p90, r.p99, r.max);
+    } else {
+        if (rows == 0) {
+            printf("impl,test,capacity,threads,ns_per_byte,mb_per_s,lat_p50_ns,lat_p90_ns,lat_p99_ns,lat_max_ns\n");
+        }
+        printf("%s,%s,%zu,%d,%.3f,%.1f,%.0f,%.0f,%.0f,%.0f\n",
+               r.impl, r.test, r.capacity, r.threads, r.nsPerByte, mbs, r.p50, r.p90, r.p99, r.max);
+    }
+    rows++;
+}
+
+// Uniform access to both implementations
+struct FifoQueue {
+    static constexpr const char *name = "fifo.c";
+    std::vector<uint8_t> storage;
+    queue_t q;
+    explicit FifoQueue(size_t capacity) : storage(capacity + 1) {   // one slot is kept free
+        q = queue_t{};
+        q.size = storage.size();
+        q.data = storage.data();
+    }
+    size_t capacity() const { return q.size - 1; }
+    bool put(uint8_t c) { return queue_write(&q, c) == 0; }
+    bool get(uint8_t &c) { return queue_read(&q, &c) == 0; }
+    bool peek(uint8_t &c) { return queue_peek(&q, &c) == 0; }
+    size_t write(const uint8_t *src, size_t n) { return queue_write_n(&q, src, n); }
+    size_t read(uint8_t *dst, size_t n) { return queue_read_n(&q, dst, n); }
+};
+
+template <size_t N>
+struct RingQueue {
+    static constexpr const char *name = "RingBuffer";
+    RingBuffer<uint8_t, N> r;
+    explicit RingQueue(size_t) {}
+    size_t capacity() const { return N; }
+    bool put(uint8_t c) { return r.put(c); }
+    bool get(uint8_t &c) { return r.get(c); }
+    bool peek(uint8_t &c) { return r.peek(c); }
+    size_t write(const uint8_t *src, size_t n) { return r.write(src, n); }
+    size_t read(uint8_t *dst, size_t n) { return r.read(dst, n); }
+};
+
+template <class Q>
+static void singleThread(Q &q) {
+    const size_t b = std::min(burst, q.capacity());
+    const size_t rounds = totalBytes / b;
+    uint32_t sum = 0;
+    uint8_t c = 0;
+    uint64_t tWrite = 0, tRead = 0, tPeek = 0;
+
+    for (size_t r=0; r<rounds; r++) {
+        uint64_t t0 = nowNs();
+        for (size_t i=0; i<b; i++) {
+            q.put((uint8_t)i);
+        }
+        uint64_t t1 = nowNs();
+        for (size_t i=0; i<b; i++) {
+            q.peek(c);
+            sum += c;
+        }
+        uint64_t t2 = nowNs();
+        for (size_t i=0; i<b; i++) {
+            q.get(c);
+            sum += c;
+        }
+        uint64_t t3 = nowNs();
+        tWrite += t1 - t0;
+        tPeek += t2 - t1;
+        tRead += t3 - t2;
+    }
+    const double n = (double)rounds * b;
+    emit({Q::name, "put", q.capacity(), 1, tWrite / n, 0, 0, 0, 0});
+    emit({Q::name, "get", q.capacity(), 1, tRead / n, 0, 0, 0, 0});
+    emit({Q::name, "peek", q.capacity(), 1, tPeek / n, 0, 0, 0, 0});
+
+    // Bulk copy of punch sized blocks
+    uint8_t punch[18] = {0x02, 0xD3, 0x0D};
+    const size_t punches = b / sizeof(punch);
+    tWrite = tRead = 0;
+    for (size_t r=0; r<rounds; r++) {
+        uint64_t t0 = nowNs();
+        for (size_t i=0; i<punches; i++) {
+            q.write(punch, sizeof(punch));
+        }
+        uint64_t t1 = nowNs();
+        for (size_t i=0; i<punches; i++) {
+            q.read(punch, sizeof(punch));
+        }
+        uint64_t t2 = nowNs();
+        tWrite += t1 - t0;
+        tRead += t2 - t1;
+    }
+    const double nb = (double)rounds * punches * sizeof(punch);
+    emit({Q::name, "write_n", q.capacity(), 1, tWrite / nb, 0, 0, 0, 0});
+    emit({Q::name, "read_n", q.capacity(), 1, tRead / nb, 0, 0, 0, 0});
+    sink = sum + punch[3];
+}
+
+// Producer writes punch sized chunks and stamps every 64th byte; the consumer
+// reads in chunks and takes the latency of each stamped byte.
+template <class Q>
+static void twoThreads(Q &q, size_t n) {
+    const size_t stampEvery = 64;
+    std::vector<uint64_t> sent(n / stampEvery + 1);
+    std::vector<double> latency;
+    latency.reserve(sent.size());
+    uint64_t errors = 0;
+
+    uint64_t start = nowNs();
+    std::thread consumer([&] {
+        uint8_t buf[64];
+        for (size_t i=0; i<n; ) {
+            size_t got = q.read(buf, sizeof(buf));
+            if (got == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            uint64_t t = nowNs();
+            for (size_t k=0; k<got; k++, i++) {
+                errors += (buf[k] != (uint8_t)(i * 7));
+                if (i % stampEvery == 0) {
+                    latency.push_back((double)(t - sent[i / stampEvery]));
+                }
+            }
+        }
+    });
+    uint8_t chunk[18];
+    for (size_t i=0; i<n; ) {
+        size_t len = std::min(sizeof(chunk), n - i);
+        for (size_t k=0; k<len; k++) {
+            chunk[k] = (uint8_t)((i + k) * 7);
+        }
+        uint64_t t = nowNs();
+        for (size_t k=0; k<len; k++) {          // stamps are stored before the bytes are published
+            if ((i + k) % stampEvery == 0) {
+                sent[(i + k) / stampEvery] = t;
+            }
+        }
+        size_t done = 0;
+        while (done < len) {
+            size_t w = q.write(chunk + done, len - done);
+            if (w == 0) {
+                std::this_thread::yield();
+            }
+            done += w;
+        }
+        i += len;
+    }
+    consumer.join();
+    double elapsed = (double)(nowNs() - start);
+
+    if (errors) {
+        fprintf(stderr, "*** %s capacity %zu: %llu bytes lost or reordered\n",
+                Q::name, q.capacity(), (unsigned long long)errors);
+    }
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&](double p) { return latency[(size_t)(p * (latency.size() - 1))]; };
+    emit({Q::name, "spsc", q.capacity(), 2, elapsed / n, pct(0.5), pct(0.9), pct(0.99), latency.back()});
+}
+
+template <size_t N>
+static void benchCapacity(size_t spscBytes) {
+    FifoQueue f(N);
+    singleThread(f);
+    twoThreads(f, spscBytes);
+    static RingQueue<N> r(N);
+    singleThread(r);
+    twoThreads(r, spscBytes);
+}
+
+int main(int argc, char **argv) {
+    json = (argc > 1 && strcmp(argv[1], "--json") == 0);
+    benchCapacity<64>(1u << 20);
+    benchCapacity<1024>(4u << 20);
+    benchCapacity<RX_QUEUE_SIZE>(4u << 20);
+    if (json) {
+        printf("\n]\n");
+    }
+    return 0;
+}
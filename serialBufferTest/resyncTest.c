@@ -0,0 +1,191 @@
+// 2023 FIF orientering
+// Host test of the punch CRC check and resynchronisation (sicrc.cpp, framer.c): the table
+// CRC against the guide's bitwise one, a corrupted length byte, and a corpus of punches with
+// bit errors, lost and extra chars and noise bursts, framed batch and byte at a time.
+// Every punch not hit must come through valid, once and in order; prints the punches lost
+// per corruption.
+
+#include <stdio.h>
+#include <string.h>
+#include "framer.h"
+#include "frameq.h"
+#include "ring.h"
+#include "check.h"
+#include "punch.h"
+
+#define PUNCHES 2000
+#define EVERY 10                // one punch in this many is corrupted
+#define BUF_SIZE (64 * 1024)
+
+static uint8_t stream[BUF_SIZE];
+static uint8_t frames[2][BUF_SIZE];     // frames seen per channel, each prefixed by its length
+static bool hit[PUNCHES];               // punches corrupted in the stream
+
+static uint32_t seed = 1;
+static uint32_t rnd(uint32_t range) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+static void testTable(void) {
+    uint8_t data[300] = {0};
+    bool same = true;
+    for (size_t count=0; count<sizeof(data); count++) {
+        for (size_t i=0; i<count; i++) {
+            data[i] = rnd(256);
+        }
+        same &= sicrc(data, count) == punch_crc_bitwise(data, count);
+    }
+    const uint8_t example[] = {0x53, 0x00, 0x05, 0x01, 0x0F, 0xB5, 0x00, 0x00, 0x1E, 0x08};
+    CHECK(same && sicrc(example, sizeof(example)) == 0x2C12);      // the guide's example
+}
+
+// Read the waiting frames of a channel into frames[chan] at *pos, each prefixed by its length
+static void drain(int chan, size_t *pos) {
+    frame_t frame;
+    ring_span_t data[2];
+    while (frameq_read(chan, &frame, data)) {
+        frames[chan][*pos] = frame.len;
+        memcpy(&frames[chan][*pos + 1], data[0].data, data[0].len);
+        memcpy(&frames[chan][*pos + 1 + data[0].len], data[1].data, data[1].len);
+        *pos += frame.len + 1;
+        frameq_release(&frame);
+    }
+}
+
+// Frame a stream on both channels, batch on 0 and byte at a time on 1: same frames.
+// Returns the bytes of frames in frames[0].
+static size_t frameBoth(size_t len) {
+    size_t fed = 0, pos[2] = {0, 0};
+    while (fed < len) {
+        size_t n = len - fed < 500 ? len - fed : 500;
+        CHECK(rxq_write(0, stream + fed, n) == n && rxq_write(1, stream + fed, n) == n);
+        fed += n;
+        framer_run(0);
+        while (framer_step(1)) {
+        }
+        drain(0, &pos[0]);
+        drain(1, &pos[1]);
+    }
+    CHECK(pos[0] == pos[1] && memcmp(frames[0], frames[1], pos[0]) == 0);
+    CHECK(rxq_count(0) == 0 && rxq_count(1) == 0);
+    return pos[0];
+}
+
+// The card number of the valid punch a frame ends with (with or without ETX), -1 if none
+static long frameCard(const uint8_t *frame, size_t len) {
+    for (int etx=1; etx>=0; etx--) {
+        size_t need = PUNCH_LEN - 1 - !etx;                         // from the header
+        if (len < need || (etx && frame[len - 1] != 0x03)) {
+            continue;
+        }
+        const uint8_t *hdr = frame + len - need;
+        uint16_t crc = sicrc(hdr, 15);
+        if (hdr[0] == 0xD3 && hdr[1] == 0x0D && hdr[15] == crc >> 8 && hdr[16] == (crc & 0xFF)) {
+            return (long)hdr[4] << 24 | hdr[5] << 16 | hdr[6] << 8 | hdr[7];
+        }
+    }
+    return -1;
+}
+
+// Punches delivered, in order, none twice; *rejected gets the channel's frames that failed
+static int delivered(size_t bytes, bool got[PUNCHES], uint32_t *rejected) {
+    framer_stats_t st;
+    int n = 0;
+    long last = -1;
+    for (size_t at=0; at<bytes; at+=frames[0][at] + 1) {
+        long card = frameCard(&frames[0][at + 1], frames[0][at]);
+        if (card >= 0) {
+            CHECK(card < PUNCHES && card > last);
+            got[card] = true;
+            last = card;
+            n++;
+        }
+    }
+    framer_stats(0, &st);
+    *rejected = st.rejected;
+    return n;
+}
+
+// A length byte hit: the punch is rejected, the punches it would have taken with it are not
+static void testLength(void) {
+    size_t len = 0;
+    bool got[PUNCHES] = {false};
+    uint32_t rejected;
+    framer_stats_t st;
+    framer_stats(0, &st);
+    for (int i=0; i<8; i++) {
+        punch_make(stream + len, 1, i, 0, 0, 0);
+        len += PUNCH_LEN;
+    }
+    stream[2] = 0x6D;                                   // 109 chars instead of 13
+    size_t bytes = frameBoth(len);
+    CHECK(delivered(bytes, got, &rejected) == 7 && !got[0] && got[7]);
+    CHECK(rejected == st.rejected + 1);
+}
+
+// Punches with noise between them, one in EVERY hit by a bit error, a lost or extra char,
+// or a burst of noise over it
+static size_t makeCorpus(int *events) {
+    size_t len = 0;
+    *events = 0;
+    for (int i=0; i<PUNCHES; i++) {
+        uint8_t p[PUNCH_LEN + 1];
+        size_t n = PUNCH_LEN;
+        punch_make(p, 1, i, rnd(256), rnd(43200), rnd(256));
+        hit[i] = i % EVERY == EVERY / 2;
+        if (hit[i]) {
+            size_t at = rnd(PUNCH_LEN), burst = 2 + rnd(7);
+            switch (rnd(4)) {
+                case 0:                                 // bit error
+                    p[at] ^= 1 << rnd(8);
+                    break;
+                case 1:                                 // lost
+                    memmove(p + at, p + at + 1, PUNCH_LEN - at - 1);
+                    n--;
+                    break;
+                case 2:                                 // extra
+                    memmove(p + at + 1, p + at, PUNCH_LEN - at);
+                    p[at] = rnd(256);
+                    n++;
+                    break;
+                default:                                // burst
+                    for (size_t j=at; j<at + burst && j<PUNCH_LEN; j++) {
+                        p[j] = rnd(256);
+                    }
+            }
+            (*events)++;
+        }
+        memcpy(stream + len, p, n);
+        len += n;
+        for (int noise=rnd(8) < 2 ? rnd(6) : 0; noise>0; noise--) {
+            stream[len++] = rnd(256);
+        }
+    }
+    return len;
+}
+
+static void testCorpus(void) {
+    int events, intact = 0, lost = 0;
+    bool got[PUNCHES] = {false};
+    uint32_t rejected;
+    framer_stats_t st;
+    framer_stats(0, &st);
+    size_t bytes = frameBoth(makeCorpus(&events));
+    delivered(bytes, got, &rejected);
+    for (int i=0; i<PUNCHES; i++) {
+        intact += !hit[i] && got[i];
+        lost += !got[i];
+    }
+    CHECK(intact == PUNCHES - events);                  // every punch not hit, none merged away
+    CHECK(lost <= events);
+    printf("resyncTest: %d corruptions, %d punches lost (%.2f per corruption), %lu frames rejected\n",
+           events, lost, (double)lost / events, (unsigned long)(rejected - st.rejected));
+}
+
+int main(void) {
+    testTable();
+    testLength();
+    testCorpus();
+    return CHECK_REPORT("resyncTest");
+}
@@ -0,0 +1,138 @@
+// 2023 FIF orientering
+// Host tests for RingBuffer<T, N> (ringbuffer.hpp) and its C interface (ring.h)
+
+#include <string.h>
+#include <thread>
+#include "ringbuffer.hpp"
+#include "ring.h"
+#include "stats.h"
+#include "hostTime.h"
+#include "check.h"
+
+static void testBytes() {
+    RingBuffer<uint8_t, 8> r;
+    uint8_t c;
+
+    CHECK(!r.get(c) && r.empty());
+    for (int i=0; i<8; i++) {
+        CHECK(r.put((uint8_t)i));                        // all N slots usable
+    }
+    CHECK(!r.put(8) && r.count() == 8 && r.space() == 0);
+    CHECK(r.peek(c) && c == 0);
+    for (int i=0; i<8; i++) {
+        CHECK(r.get(c) && c == i);
+    }
+
+    // Wrapped spans: indices at 8, move them to 13
+    uint8_t buf[16];
+    CHECK(r.write((const uint8_t *)"abcde", 5) == 5);
+    CHECK(r.read(buf, 5) == 5);
+    CHECK(r.write((const uint8_t *)"0123456789", 10) == 8);
+    RingBuffer<uint8_t, 8>::Span span[2];
+    CHECK(r.readSpans(span) == 8);
+    CHECK(span[0].len == 3 && memcmp(span[0].data, "012", 3) == 0);
+    CHECK(span[1].len == 5 && memcmp(span[1].data, "34567", 5) == 0);
+    r.consume(4);
+    CHECK(r.writeSpans(span) == 4 && span[0].len == 3 && span[1].len == 1);
+
+    // Move into a smaller ring across both wraps
+    RingBuffer<uint8_t, 4> small;
+    CHECK(small.write((const uint8_t *)"xyz", 3) == 3 && small.read(buf, 2) == 2);
+    CHECK(small.moveFrom(r, 10) == 3);                   // space for 3
+    CHECK(small.read(buf, 4) == 4 && memcmp(buf, "z456", 4) == 0);
+    CHECK(r.read(buf, 8) == 1 && buf[0] == '7');
+}
+
+// Overflow accounting: enqueued, dropped, drop times and high-water mark
+static void testStats() {
+    RingBuffer<uint8_t, 16> r;
+    uint8_t buf[16] = {};
+    ring_stats_t st = r.stats();
+    CHECK(st.enqueued == 0 && st.dropped == 0 && st.highWater == 0);
+
+    CHECK(r.write(buf, 10) == 10 && r.read(buf, 10) == 10);
+    CHECK(r.write(buf, 5) == 5);
+    st = r.stats();
+    CHECK(st.enqueued == 15 && st.highWater == 10 && st.dropped == 0);
+
+    hostTimeUs = 5000;
+    CHECK(r.write(buf, 16) == 11);                      // 5 dropped
+    hostTimeUs = 7000;
+    CHECK(!r.put(1));                                   // 1 more
+    st = r.stats();
+    CHECK(st.enqueued == 26 && st.dropped == 6 && st.highWater == 16);
+    CHECK(st.firstDropMs == 5 && st.lastDropMs == 7);
+
+    r.read(buf, 16);
+    CHECK(r.put(1) && r.stats().highWater == 16);       // the mark stays
+
+    // Through the C interface and the stats surface
+    stats_t stats;
+    rxq_put(0, 0x02);
+    stats_collect(&stats);
+    CHECK(stats.rxQueue[0].enqueued >= 1 && stats.frameQueue[0].dropped == 0);
+    CHECK(rxq_get(0, buf));
+}
+
+// Records, as used for the future frame queues
+struct record {
+    uint32_t time;
+    uint8_t chan;
+};
+
+static void testRecords() {
+    RingBuffer<record, 4> r;
+    record rec;
+    for (uint32_t i=0; i<100; i++) {
+        CHECK(r.put({i, (uint8_t)(i & 1)}));
+        CHECK(r.get(rec) && rec.time == i && rec.chan == (i & 1));
+    }
+}
+
+static void testShim() {
+    const uint8_t punch[] = {0x02, 0xD3, 0x0D, 1, 2, 3};
+    uint8_t buf[sizeof(punch)];
+    CHECK(rxq_write(1, punch, sizeof(punch)) == sizeof(punch));
+    CHECK(rxq_count(0) == 0 && rxq_count(1) == sizeof(punch));
+    ring_span_t span[2];
+    CHECK(rxq_read_spans(1, span) == sizeof(punch) && span[1].len == 0);
+    CHECK(memcmp(span[0].data, punch, sizeof(punch)) == 0);
+    rxq_consume(1, 2);
+    CHECK(rxq_read(1, buf, sizeof(buf)) == 4 && buf[0] == 0x0D);
+    CHECK(rxq_space(1) == RX_QUEUE_SIZE);
+}
+
+// Producer and consumer threads; the consumer checks for loss or reordering
+static void testTwoThreads() {
+    static RingBuffer<uint32_t, 64> r;
+    const uint32_t n = 2000000;
+    uint32_t errors = 0;
+    std::thread consumer([&] {
+        uint32_t v;
+        for (uint32_t i=0; i<n; ) {
+            if (r.get(v)) {
+                errors += (v != i++);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (uint32_t i=0; i<n; ) {
+        if (r.put(i)) {
+            i++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    CHECK(errors == 0 && r.empty());
+}
+
+int main() {
+    testBytes();
+    testStats();
+    testRecords();
+    testShim();
+    testTwoThreads();
+    return CHECK_REPORT("ringTest");
+}
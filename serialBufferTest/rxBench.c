@@ -0,0 +1,69 @@
+// 2023 FIF orientering
+// Host benchmark of the CPU cost of UART reception: the interrupt handler (uartrx.c)
+// draining a simulated FIFO against the DMA poll (dmarx.c) reading a simulated transfer
+// count. The characters cost the DMA path nothing, so its cost per byte falls with the
+// number of bytes found per poll. Prints CSV: path,bytes_per_call,ns_per_call,ns_per_byte
+
+#include <stdio.h>
+#include <time.h>
+#include "uartrx.h"
+#include "dmarx.h"
+#include "ring.h"
+
+static const size_t totalBytes = 16u << 20;
+
+static uint32_t fifo[RX_QUEUE_SIZE];
+static size_t fifoLen, fifoPos;
+static uint32_t dmaCount = DMARX_COUNT;
+
+static bool simReadable(int chan) { (void)chan; return fifoPos < fifoLen; }
+static uint32_t simRead(int chan) { (void)chan; return fifo[fifoPos++]; }
+static uint32_t simTransferCount(int chan) { (void)chan; return dmaCount; }
+static uint32_t simLineErrors(int chan) { (void)chan; return 0; }
+
+static const uartrx_port_t uartPort = {simReadable, simRead};
+static const dmarx_port_t dmaPort = {simTransferCount, simLineErrors};
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void emit(const char *path, size_t perCall, uint64_t ns) {
+    double calls = (double)totalBytes / perCall;
+    printf("%s,%zu,%.1f,%.3f\n", path, perCall, ns / calls, ns / (double)totalBytes);
+}
+
+static void benchIrq(size_t perCall) {
+    uint64_t start = nowNs();
+    for (size_t done=0; done<totalBytes; done+=perCall) {
+        fifoLen = perCall;                          // the FIFO filled up meanwhile
+        fifoPos = 0;
+        uartrx_irq(0);
+        rxq_consume(0, rxq_count(0));
+    }
+    emit("irq", perCall, nowNs() - start);
+}
+
+static void benchDma(size_t perCall) {
+    uint64_t start = nowNs();
+    for (size_t done=0; done<totalBytes; done+=perCall) {
+        dmaCount -= perCall;                        // the DMA wrote meanwhile
+        dmarx_poll(0);
+        rxq_consume(0, rxq_count(0));
+    }
+    emit("dma", perCall, nowNs() - start);
+}
+
+int main(void) {
+    static const size_t sizes[] = {1, 4, 16, 32, 128, 1024};
+    uartrx_init(&uartPort);
+    dmarx_init(&dmaPort);
+    printf("path,bytes_per_call,ns_per_call,ns_per_byte\n");
+    for (size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++) {
+        benchIrq(sizes[i]);
+        benchDma(sizes[i]);
+    }
+    return 0;
+}
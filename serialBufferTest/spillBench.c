@@ -0,0 +1,154 @@
+// 2023 FIF orientering
+// Host benchmark of the spill to flash (spill.c, flashlog.c) with the radio link down: punches
+// arrive at random on all inputs at the offered rate for RUN_S, and every one that does not
+// fit the queues any more is lost. The main loop is the Pico's (main.c): the modem takes
+// bytes for HOLD_AFTER_MS, then holds CTS for the rest of the run, with frames stalled in
+// the transmit engine and a packet gathered by pack.c held for it. On a simulated flash with the W25Q16JV's typical and
+// maximum erase and program times, the loop waiting out each operation as on the Pico
+// (main.c) while punches still arrive (the rx DMA). By flash and offered rate: punches
+// spilled per second and the bytes per second the log took, punches lost, the frame queue's
+// peak fill (the headroom above SPILL_HIGH the flash used), the longest the loop stalled for
+// the flash, and the host CPU time of spill_poll: mean per pass, per frame spilled and the
+// longest pass. Prints CSV.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "spill.h"
+#include "arbiter.h"
+#include "pack.h"
+#include "txeng.h"
+#include "cts.h"
+#include "flashSim.h"
+#include "hostTime.h"
+#include "punch.h"
+
+#define RUN_S 20
+#define STEP_US 1000
+#define HOLD_AFTER_MS 100
+#define LINE_BYTES_STEP 4       // the line when CTS is clear, 38400 baud
+
+static uint32_t seed;
+static uint32_t rnd(uint32_t range) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) % range;
+}
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static struct {
+    const uint8_t *at;          // the DMA's next byte
+    size_t remaining;
+} line;
+
+static void lineStart(const uint8_t *data, size_t len) {
+    line.at = data;
+    line.remaining = len;
+}
+
+static const txeng_port_t linePort = {lineStart};
+
+// The main loop after the flash: the modem takes bytes while CTS is clear, packets are handed
+// to the engine
+static void transmit(void) {
+    frame_t frame;
+    ring_span_t data[2];
+    for (int i=0; !cts_held() && i<LINE_BYTES_STEP && line.remaining > 0; i++) {
+        line.at++;
+        if (--line.remaining == 0) {
+            txeng_irq();
+        }
+    }
+    while (txeng_ready() && pack_next(&frame, data)) {
+        txeng_submit(&frame, data);
+    }
+}
+
+static bool queued(void) {
+    for (int chan=0; chan<Nchannels; chan++) {
+        if (frameq_count(chan) > 0) {
+            return true;
+        }
+    }
+    return flashlog_pages() > 0 || !flashlog_idle() || pack_due_us() != UINT32_MAX || !txeng_idle();
+}
+
+// The link back until all is sent, for the next run to start empty
+static void drain(void) {
+    cts_edge(true, (uint32_t)hostTimeUs);
+    while (queued()) {
+        hostTimeUs += STEP_US;
+        spill_poll();
+        transmit();
+    }
+}
+
+static void bench(const char *flash, uint32_t eraseUs, uint32_t programUs, uint32_t offered) {
+    uint8_t p[PUNCH_LEN];
+    spill_stats_t st;
+    uint32_t made = 0, lost = 0, peak = 0, stallUs = 0;
+    uint64_t pollNs = 0, maxPollNs = 0, arrivedUs = 0;
+    long steps = 0;
+    seed = 12345;
+    hostTimeUs = 0;
+    flashsim_init(eraseUs, programUs);
+    flashSim.wait = true;
+    arbiter_init(ARB_ROUND_ROBIN);
+    spill_init(&flashSimPort, FLASHSIM_SIZE, SPILL_HIGH, SPILL_LOW);
+    cts_init(true, true, (uint32_t)hostTimeUs);
+    pack_init(PACKET_MAX, PACKET_FLUSH_MS * 1000u, PACKET_GAP_MS * 1000u, true);
+    txeng_init(&linePort);
+    memset(&line, 0, sizeof(line));
+    uint32_t perStep = offered * STEP_US / Nchannels;                   // chance per channel [1e-6]
+    while (hostTimeUs < RUN_S * 1000000ull) {
+        hostTimeUs += STEP_US;
+        if (hostTimeUs >= HOLD_AFTER_MS * 1000u && !cts_held()) {
+            cts_edge(false, (uint32_t)hostTimeUs);
+        }
+        for (; arrivedUs < hostTimeUs; arrivedUs+=STEP_US) {           // Steps the loop stalled too
+            for (int chan=0; chan<Nchannels; chan++) {
+                if (rnd(1000000) < perStep) {
+                    punch_make(p, 31 + chan, ++made, 0, 0, 0);
+                    if (fq_space(chan) > 0 && rxq_space(chan) >= PUNCH_LEN) {
+                        rxq_write(chan, p, PUNCH_LEN);
+                        frameq_commit(chan, PUNCH_LEN, (uint32_t)arrivedUs);
+                    } else {
+                        lost++;
+                    }
+                }
+                peak = frameq_count(chan) > peak ? frameq_count(chan) : peak;
+            }
+        }
+        uint64_t at = hostTimeUs, start = nowNs();
+        spill_poll();
+        uint64_t ns = nowNs() - start;
+        pollNs += ns;
+        maxPollNs = ns > maxPollNs ? ns : maxPollNs;
+        stallUs = hostTimeUs - at > stallUs ? (uint32_t)(hostTimeUs - at) : stallUs;
+        steps++;
+        transmit();
+    }
+    spill_stats(&st);
+    drain();
+    printf("%s,%lu,%lu,%.1f,%.0f,%lu,%lu,%lu,%lu,%lu,%lu,%.0f,%.0f,%.0f\n", flash, (unsigned long)eraseUs / 1000,
+           (unsigned long)offered, (double)st.frames / RUN_S,
+           (double)(st.bytes + st.frames * SPILL_RECORD_HEAD) / RUN_S, (unsigned long)made, (unsigned long)lost,
+           (unsigned long)(peak * 100 / FRAME_QUEUE_SIZE), (unsigned long)stallUs / 1000,
+           (unsigned long)st.log.programs, (unsigned long)st.log.erases, (double)pollNs / steps,
+           st.frames ? (double)pollNs / st.frames : 0.0, (double)maxPollNs);
+}
+
+int main(void) {
+    const uint32_t offered[] = {50, 100, 200, 400, 800, 1600};        // punches/s, all inputs
+    printf("flash,erase_ms,offered_pps,spilled_pps,log_Bps,punches,lost,peak_frame_queue_pct,longest_stall_ms,"
+           "programs,erases,ns_per_poll,ns_per_frame,max_poll_ns\n");
+    for (unsigned o=0; o<sizeof(offered) / sizeof(offered[0]); o++) {
+        bench("typical", FLASHSIM_ERASE_US, FLASHSIM_PROGRAM_US, offered[o]);
+        bench("worst", FLASHSIM_ERASE_MAX_US, FLASHSIM_PROGRAM_MAX_US, offered[o]);
+    }
+    return 0;
+}
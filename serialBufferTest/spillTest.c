@@ -0,0 +1,283 @@
+// 2023 FIF orientering
+// Host test of the flash log (flashlog.c) and the spill to it (spill.c) on a simulated flash.
+// The log: records of any length read back in order over many laps of a small region, every
+// sector erased as often as any other, no operation on a busy flash, and after a restart the
+// writer goes on past the newest sector. The spill: a mass start on two channels with the
+// radio link down for a minute overflows the queues without it; with it no punch is lost,
+// and when the link comes back every punch goes out once, each channel's in order. With the
+// packets of pack.c and the transmit engine, the modem holding CTS through an outage longer
+// than the rx queues hold: the frames held in a packet and in the engine are copies, so the
+// spill frees the queues as before; no punch is lost, every one goes over the line whole
+// and in order, and no rx queue ever counts more than it holds.
+
+#include <string.h>
+#include "spill.h"
+#include "arbiter.h"
+#include "pack.h"
+#include "txeng.h"
+#include "cts.h"
+#include "flashSim.h"
+#include "hostTime.h"
+#include "check.h"
+#include "punch.h"
+
+#define LOG_SECTORS 16
+#define RECORDS 20000
+
+static uint8_t page[FLASHLOG_PAGE];
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Check the records of a page read back: length, number, the number's low byte as filler
+static uint32_t readPage(uint32_t expect) {
+    for (size_t at=FLASHLOG_HEAD; at<FLASHLOG_PAGE && page[at] != 0xFF; at+=page[at]) {
+        uint8_t len = page[at];
+        CHECK(len >= 5 && get32(page + at + 1) == expect);
+        for (int i=5; i<len; i++) {
+            CHECK(page[at + i] == (expect & 0xFF));
+        }
+        expect++;
+    }
+    return expect;
+}
+
+static void testLog(void) {
+    flashsim_init(FLASHSIM_ERASE_US, FLASHSIM_PROGRAM_US);
+    flashlog_init(&flashSimPort, LOG_SECTORS * FLASHLOG_SECTOR);
+    uint32_t written = 0, read = 0;
+    while (read < RECORDS) {
+        hostTimeUs += 100;
+        uint8_t len = 5 + written % 50;
+        uint8_t *record = written < RECORDS ? flashlog_reserve(len) : NULL;
+        if (record) {
+            record[0] = len;
+            memcpy(record + 1, &written, 4);        // Little endian host
+            memset(record + 5, written & 0xFF, len - 5);
+            written++;
+        } else if (written == RECORDS) {
+            flashlog_seal();
+        }
+        flashlog_poll();
+        if (hostTimeUs % 20000 == 0 && flashlog_read(page)) {   // The reader lags
+            read = readPage(read);
+        }
+    }
+    flashlog_stats_t st;
+    flashlog_stats(&st);
+    uint32_t least = UINT32_MAX, most = 0;
+    for (int s=0; s<LOG_SECTORS; s++) {
+        least = flashSim.erases[s] < least ? flashSim.erases[s] : least;
+        most = flashSim.erases[s] > most ? flashSim.erases[s] : most;
+    }
+    CHECK(read == RECORDS && flashSim.errors == 0 && st.pages == 0);
+    CHECK(least >= 5 && most - least <= 1);
+    CHECK(st.full > 0 && st.maxPages <= (LOG_SECTORS - 1) * FLASHLOG_SECTOR / FLASHLOG_PAGE);
+    printf("spillTest: %lu pages, %lu erases, %lu..%lu per sector\n", (unsigned long)st.programs,
+           (unsigned long)st.erases, (unsigned long)least, (unsigned long)most);
+
+    // Restart: on from the sector after the newest page, the two erased ahead not erased again
+    uint32_t next = (flashSim.lastProgram / FLASHLOG_SECTOR + 1) % LOG_SECTORS * FLASHLOG_SECTOR;
+    flashlog_init(&flashSimPort, LOG_SECTORS * FLASHLOG_SECTOR);
+    CHECK(flashlog_pages() == 0 && !flashlog_read(page));
+    CHECK(flashlog_reserve(10) != NULL);
+    flashlog_seal();
+    while (!flashlog_idle()) {
+        hostTimeUs += 100;
+        flashlog_poll();
+    }
+    flashlog_stats(&st);
+    CHECK(flashSim.lastProgram == next && st.programs == 1);
+    CHECK(st.erases == 1 && flashSim.lastErase == (next + 2 * FLASHLOG_SECTOR) % (LOG_SECTORS * FLASHLOG_SECTOR));
+    CHECK(flashlog_read(page) && flashlog_pages() == 0);
+}
+
+#define CHANNELS 2
+#define PUNCH_MS 50             // per channel
+#define OUTAGE_S 60
+#define SEND_MS 40              // the link back: a punch per, faster than they come
+
+static struct {
+    uint32_t made[CHANNELS], lost;
+    uint32_t sent[CHANNELS], misordered, spilled;
+    uint32_t overfull;          // steps an rx queue counted more than it holds
+} run;
+
+// A punch per channel every PUNCH_MS, lost if the queues have no room
+static void punchIn(void) {
+    uint8_t p[PUNCH_LEN];
+    uint32_t ms = (uint32_t)(hostTimeUs / 1000);
+    for (int chan=0; chan<CHANNELS; chan++) {
+        if (ms % PUNCH_MS == (uint32_t)chan * 7) {
+            punch_make(p, 31 + chan, ++run.made[chan], 0, 0, 0);
+            if (fq_space(chan) > 0 && rxq_space(chan) >= PUNCH_LEN) {
+                rxq_write(chan, p, PUNCH_LEN);
+                frameq_commit(chan, PUNCH_LEN, (uint32_t)hostTimeUs);
+            } else {
+                run.lost++;
+            }
+        }
+    }
+}
+
+static void step(bool punching, bool linkUp) {
+    frame_t frame;
+    ring_span_t data[2];
+    hostTimeUs += 1000;
+    uint32_t ms = (uint32_t)(hostTimeUs / 1000);
+    if (punching) {
+        punchIn();
+    }
+    spill_poll();
+    if (linkUp && ms % SEND_MS == 0 && spill_next(&frame, data)) {
+        uint8_t sent[PUNCH_LEN];
+        memcpy(sent, data[0].data, data[0].len);
+        memcpy(sent + data[0].len, data[1].data, data[1].len);
+        uint32_t card = sent[5] << 24 | sent[6] << 16 | sent[7] << 8 | sent[8];
+        run.misordered += frame.len != PUNCH_LEN || card != run.sent[frame.chan] + 1;
+        run.sent[frame.chan] = card;
+        run.spilled += frame.spilled;
+        spill_release(&frame);
+    }
+}
+
+static bool queued(void) {
+    for (int chan=0; chan<CHANNELS; chan++) {
+        if (frameq_count(chan) > 0) {
+            return true;
+        }
+    }
+    return flashlog_pages() > 0;
+}
+
+static void massStart(bool spill) {
+    memset(&run, 0, sizeof(run));
+    flashsim_init(FLASHSIM_ERASE_MAX_US, FLASHSIM_PROGRAM_MAX_US);        // Slowest flash
+    arbiter_init(ARB_ROUND_ROBIN);
+    spill_init(&flashSimPort, spill ? FLASHSIM_SIZE : 0, SPILL_HIGH, SPILL_LOW);
+    for (long ms=0; ms<OUTAGE_S * 1000L; ms++) {
+        step(true, false);
+    }
+    for (long ms=0; ms<OUTAGE_S * 1000L; ms++) {                   // The link back
+        step(true, true);
+    }
+    while (queued()) {
+        step(false, true);
+    }
+}
+
+static void testMassStart(void) {
+    spill_stats_t st;
+    massStart(false);
+    CHECK(run.lost > 1000 && run.spilled == 0);                    // Gaps in every channel
+    massStart(true);
+    spill_stats(&st);
+    CHECK(run.lost == 0 && run.misordered == 0 && flashSim.errors == 0);
+    CHECK(run.sent[0] == run.made[0] && run.sent[1] == run.made[1]);
+    CHECK(st.spills > 0 && run.spilled == st.frames && st.drained == st.frames && st.log.pages == 0);
+    for (int chan=0; chan<CHANNELS; chan++) {
+        CHECK(rxq_count(chan) == 0 && frameq_count(chan) == 0);
+    }
+    printf("spillTest: %lu punches, %lu through flash in %lu pages, most %lu pages held\n",
+           (unsigned long)(run.made[0] + run.made[1]), (unsigned long)st.frames,
+           (unsigned long)st.log.programs, (unsigned long)st.log.maxPages);
+}
+
+#define LINE_BYTES_MS 4         // the line when CTS is clear, 38400 baud
+#define HELD_S 120              // more than an rx queue holds
+
+static struct {
+    const uint8_t *at;          // the DMA's next byte
+    size_t remaining;
+    uint8_t out[128 * 1024];    // bytes over the line
+    size_t sent;
+} line;
+
+static void lineStart(const uint8_t *data, size_t len) {
+    line.at = data;
+    line.remaining = len;
+}
+
+static const txeng_port_t linePort = {lineStart};
+
+// The modem takes bytes while CTS is clear; the main loop's order (main.c)
+static void stepLine(bool punching, bool clear) {
+    frame_t frame;
+    ring_span_t data[2];
+    hostTimeUs += 1000;
+    if (punching) {
+        punchIn();
+    }
+    if (clear == cts_held()) {
+        cts_edge(clear, (uint32_t)hostTimeUs);
+    }
+    for (int i=0; clear && i<LINE_BYTES_MS && line.remaining > 0; i++) {
+        line.out[line.sent++] = *line.at++;             // Read as the DMA reads it
+        if (--line.remaining == 0) {
+            txeng_irq();
+        }
+    }
+    spill_poll();
+    while (txeng_ready() && pack_next(&frame, data)) {
+        txeng_submit(&frame, data);
+    }
+    for (int chan=0; chan<CHANNELS; chan++) {
+        run.overfull += rxq_count(chan) > RX_QUEUE_SIZE;
+    }
+}
+
+static void testCtsHeld(void) {
+    spill_stats_t st;
+    pack_stats_t pk;
+    memset(&run, 0, sizeof(run));
+    memset(&line, 0, sizeof(line));
+    flashsim_init(FLASHSIM_ERASE_MAX_US, FLASHSIM_PROGRAM_MAX_US);
+    arbiter_init(ARB_ROUND_ROBIN);
+    spill_init(&flashSimPort, FLASHSIM_SIZE, SPILL_HIGH, SPILL_LOW);
+    cts_init(true, true, (uint32_t)hostTimeUs);
+    pack_init(PACKET_MAX, PACKET_FLUSH_MS * 1000, PACKET_GAP_MS * 1000, true);
+    txeng_init(&linePort);
+    for (long ms=0; ms<1000; ms++) {
+        stepLine(true, true);
+    }
+    for (long ms=0; ms<HELD_S * 1000L; ms++) {                     // CTS held: nothing goes
+        stepLine(true, false);
+    }
+    while (queued() || pack_due_us() != UINT32_MAX || !txeng_idle()) {
+        stepLine(false, true);
+    }
+    pack_stats(&pk);
+    spill_stats(&st);
+    CHECK(pk.ctsHeld > 0 && st.frames > 1000);                     // Packets held, frames spilled
+    uint32_t corrupt = 0, got = 0;
+    for (size_t at=0; at + PUNCH_LEN <= line.sent; at+=PUNCH_LEN) {
+        uint8_t *q = line.out + at;
+        uint16_t crc = sicrc(q + 1, PUNCH_LEN - 4);
+        int chan = (q[3] << 8 | q[4]) - 31;
+        uint32_t card = q[5] << 24 | q[6] << 16 | q[7] << 8 | q[8];
+        if (q[0] != 0x02 || q[PUNCH_LEN - 1] != 0x03 || q[PUNCH_LEN - 3] != crc >> 8
+            || q[PUNCH_LEN - 2] != (crc & 0xFF) || chan < 0 || chan >= CHANNELS) {
+            corrupt++;
+            continue;
+        }
+        run.misordered += card != run.sent[chan] + 1;
+        run.sent[chan] = card;
+        got++;
+    }
+    CHECK(corrupt == 0 && run.overfull == 0 && run.misordered == 0 && line.sent % PUNCH_LEN == 0);
+    CHECK(run.lost == 0 && got == run.made[0] + run.made[1]);
+    for (int chan=0; chan<CHANNELS; chan++) {
+        CHECK(rxq_count(chan) == 0 && frameq_count(chan) == 0);
+    }
+    printf("spillTest: CTS held, %lu punches, %lu lost, %lu through flash, %lu packets held\n",
+           (unsigned long)(run.made[0] + run.made[1]), (unsigned long)run.lost, (unsigned long)st.frames,
+           (unsigned long)pk.ctsHeld);
+}
+
+int main(void) {
+    testLog();
+    testMassStart();
+    testCtsHeld();
+    return CHECK_REPORT("spillTest");
+}
@@ -0,0 +1,155 @@
+// 2023 FIF orientering
+// Host test of the transmit engine (txeng.c) against a simulated DMA channel and UART:
+// the DMA fills the 32 byte TX FIFO while it has room and interrupts when its count runs
+// out, the UART shifts one byte per character time onto the line while CTS is high.
+
+#include <string.h>
+#include "txeng.h"
+#include "hostTime.h"
+#include "check.h"
+
+#define TX_FIFO_DEPTH 32
+#define CHAR_US 260             // 10 bits at 38400 baud
+
+static struct {
+    const uint8_t *data;        // DMA read address
+    size_t remaining;           // DMA transfer count
+    int fifo;                   // bytes in the TX FIFO
+    uint8_t fifoData[TX_FIFO_DEPTH];
+    bool cts;
+    uint8_t line[8192];         // bytes sent
+    size_t sent;
+} sim;
+
+static void simStart(const uint8_t *data, size_t len) {
+    CHECK(sim.remaining == 0);                      // never started while busy
+    sim.data = data;
+    sim.remaining = len;
+}
+
+static const txeng_port_t simPort = {simStart};
+
+// One character time
+static void simTick(void) {
+    if (sim.remaining > 0) {
+        while (sim.remaining > 0 && sim.fifo < TX_FIFO_DEPTH) {
+            sim.fifoData[sim.fifo++] = *sim.data++;
+            sim.remaining--;
+        }
+        if (sim.remaining == 0) {
+            txeng_irq();
+        }
+    }
+    if (sim.cts && sim.fifo > 0) {
+        sim.line[sim.sent++] = sim.fifoData[0];
+        memmove(sim.fifoData, sim.fifoData + 1, --sim.fifo);
+    }
+    hostTimeUs += CHAR_US;
+}
+
+static void simRun(int ticks) {
+    for (int t=0; t<ticks; t++) {
+        simTick();
+    }
+}
+
+static uint8_t src[8192];       // frame bytes, where the rx queue would hold them
+
+// Submit len bytes of src from at, in two pieces (as at the rx queue end) when 0 < split < len
+static void submit(size_t at, size_t len, size_t split, uint32_t arrival) {
+    frame_t frame = {.arrival = arrival, .chan = 0, .len = len, .offset = at, .end = at + len};
+    if (split == 0 || split > len) {
+        split = len;
+    }
+    ring_span_t data[2] = {{src + at, split}, {src + at + split, len - split}};
+    txeng_submit(&frame, data);
+}
+
+// A packet of frames queued: the others start from the completion interrupt
+static void testBackToBack(void) {
+    txeng_stats_t st;
+    sim.cts = true;
+    for (int i=0; i<TXENG_FRAMES; i++) {
+        submit(18 * i, 18, 18, (uint32_t)hostTimeUs);
+    }
+    CHECK(!txeng_ready());                          // all taken
+    simRun(18 * TXENG_FRAMES + 50);
+    CHECK(sim.sent == 18 * TXENG_FRAMES && memcmp(sim.line, src, 18 * TXENG_FRAMES) == 0);
+    CHECK(txeng_idle() && txeng_ready());
+    txeng_stats(&st);
+    CHECK(st.frames == TXENG_FRAMES && st.bytes == 18 * TXENG_FRAMES && st.backToBack == TXENG_FRAMES - 1);
+}
+
+// CTS low: the frame stays in flight until the radio takes bytes again
+static void testCtsStall(void) {
+    txeng_stats_t st;
+    sim.sent = 0;
+    sim.cts = false;
+    submit(100, 40, 40, (uint32_t)hostTimeUs - 1000);  // waited 1 ms for the engine
+    simRun(200);
+    CHECK(sim.sent == 0 && !txeng_idle());
+    CHECK(sim.remaining == 40 - TX_FIFO_DEPTH);      // the FIFO took what it could
+    CHECK(txeng_ready());                           // the next frame can be queued
+    sim.cts = true;
+    simRun(60);
+    CHECK(sim.sent == 40 && memcmp(sim.line, src + 100, 40) == 0 && txeng_idle());
+    txeng_stats(&st);
+    CHECK(st.maxFrameUs >= 200 * CHAR_US);
+    CHECK(st.submitted == TXENG_FRAMES + 1 && st.maxWaitUs == 1000 && st.sumWaitUs == 1000);
+}
+
+// The engine sends its own copy: the frame's bytes may be freed, and overwritten, once it is
+// submitted, while CTS holds it
+static void testCopy(void) {
+    uint8_t bytes[60];
+    memcpy(bytes, src + 200, sizeof(bytes));
+    frame_t frame = {.arrival = (uint32_t)hostTimeUs, .chan = 0, .len = sizeof(bytes)};
+    ring_span_t data[2] = {{bytes, 25}, {bytes + 25, sizeof(bytes) - 25}};
+    sim.sent = 0;
+    sim.cts = false;
+    txeng_submit(&frame, data);
+    memset(bytes, 0x55, sizeof(bytes));
+    simRun(100);
+    CHECK(sim.sent == 0);
+    sim.cts = true;
+    simRun(100);
+    CHECK(sim.sent == sizeof(bytes) && memcmp(sim.line, src + 200, sizeof(bytes)) == 0 && txeng_idle());
+}
+
+// A main loop moving frames of varying length, some in two pieces, while CTS toggles:
+// the line gets every byte in order, a frame completes once
+static void testStream(void) {
+    txeng_stats_t before, after;
+    size_t queued = 0;
+    int len = 1, frames = 0;
+    txeng_stats(&before);
+    sim.sent = 0;
+    for (int t=0; t<20000; t++) {
+        sim.cts = (t / 37) % 4 != 0;
+        if (txeng_ready() && queued + len <= sizeof(src)) {
+            submit(queued, len, (frames % 3) * 7, (uint32_t)hostTimeUs);
+            queued += len;
+            frames++;
+            len = (len + 11) % FRAME_MAX + 1;
+        }
+        simTick();
+    }
+    sim.cts = true;
+    simRun(1000);
+    txeng_stats(&after);
+    CHECK(txeng_idle() && after.frames - before.frames == (uint32_t)frames);
+    CHECK(sim.sent == queued && memcmp(sim.line, src, queued) == 0);
+}
+
+int main(void) {
+    for (size_t i=0; i<sizeof(src); i++) {
+        src[i] = (uint8_t)(i * 7 + i / 256);
+    }
+    txeng_init(&simPort);
+    CHECK(txeng_idle() && txeng_ready());
+    testBackToBack();
+    testCtsStall();
+    testCopy();
+    testStream();
+    return CHECK_REPORT("txengTest");
+}
@@ -0,0 +1,121 @@
+// 2023 FIF orientering
+// Host test of the interrupt driven UART reception (uartrx.c) against a simulated
+// PL011 UART: 32 character RX FIFO, RX interrupt at 1/2 full, RX timeout after 32 bit
+// times without a new character, and a configurable interrupt latency.
+
+#include <string.h>
+#include "uartrx.h"
+#include "ring.h"
+#include "check.h"
+
+#define LEVEL 16                // RX FIFO level interrupt, as RX_FIFO_LEVEL in main.c
+#define TIMEOUT_CHARS 4         // 32 bit times, rounded up to whole 10 bit characters
+
+static struct {
+    uint32_t fifo[UARTRX_FIFO_DEPTH];
+    int count;
+    int head;
+    int idle;                   // character times since the last arrival
+    int pending;                // character times until the handler runs, -1 if none
+} uart[Nchannels];
+
+static bool simReadable(int chan) {
+    return uart[chan].count > 0;
+}
+
+static uint32_t simRead(int chan) {
+    uint32_t dr = uart[chan].fifo[uart[chan].head];
+    uart[chan].head = (uart[chan].head + 1) % UARTRX_FIFO_DEPTH;
+    uart[chan].count--;
+    return dr;
+}
+
+static const uartrx_port_t simPort = {simReadable, simRead};
+
+// A character (with error flags) arrives at the receiver
+static void simArrive(int chan, uint32_t dr) {
+    uart[chan].idle = 0;
+    if (uart[chan].count == UARTRX_FIFO_DEPTH) {       // full: lost, flagged on the last entry
+        int last = (uart[chan].head + UARTRX_FIFO_DEPTH - 1) % UARTRX_FIFO_DEPTH;
+        uart[chan].fifo[last] |= UARTRX_OE;
+        return;
+    }
+    uart[chan].fifo[(uart[chan].head + uart[chan].count) % UARTRX_FIFO_DEPTH] = dr;
+    uart[chan].count++;
+}
+
+// Feed n characters (or idle line when data is NULL), one per character time.
+// The interrupt handler runs latency character times after an interrupt condition.
+static void simRun(int chan, const uint32_t *data, int n, int latency) {
+    for (int t=0; t<n; t++) {
+        if (data) {
+            simArrive(chan, data[t]);
+        } else {
+            uart[chan].idle++;
+        }
+        bool level = uart[chan].count >= LEVEL;
+        bool timeout = uart[chan].count > 0 && uart[chan].idle >= TIMEOUT_CHARS;
+        if ((level || timeout) && uart[chan].pending < 0) {
+            uart[chan].pending = latency;
+        }
+        if (uart[chan].pending >= 0 && uart[chan].pending-- == 0) {
+            uartrx_irq(chan);
+            uart[chan].pending = -1;
+        }
+    }
+}
+
+static uint32_t stream[4096];
+
+static void testBurstDrain(void) {
+    uartrx_stats_t st;
+    uint8_t out[4096];
+    for (int i=0; i<4096; i++) {
+        stream[i] = (uint8_t)(i * 13);
+    }
+    simRun(0, stream, 4096, 2);
+    simRun(0, NULL, 10, 2);                             // idle line: timeout takes the tail
+    uartrx_stats(0, &st);
+    CHECK(st.bytes == 4096 && st.overruns == 0);
+    CHECK(st.irqs <= 4096 / LEVEL + 1);                 // bursts, not one interrupt per char
+    CHECK(rxq_read(0, out, sizeof(out)) == 4096);
+    bool same = true;
+    for (int i=0; i<4096; i++) {
+        same &= (out[i] == (uint8_t)(i * 13));
+    }
+    CHECK(same);
+}
+
+static void testLineErrors(void) {
+    uartrx_stats_t st;
+    uint8_t out[8];
+    uint32_t line[] = {0x02, 0xD3 | UARTRX_FE, 0x00 | UARTRX_BE, 0x0D | UARTRX_PE};
+    simRun(1, line, 4, 0);
+    simRun(1, NULL, 10, 0);
+    uartrx_stats(1, &st);
+    CHECK(st.framingErrors == 1 && st.parityErrors == 1 && st.breaks == 1);
+    CHECK(st.bytes == 3);                               // the break is not a character
+    CHECK(rxq_read(1, out, sizeof(out)) == 3 && out[1] == 0xD3 && out[2] == 0x0D);
+}
+
+// Interrupts held off longer than the FIFO lasts: the UART overruns
+static void testOverrun(void) {
+    uartrx_stats_t st;
+    uint8_t out[64];
+    simRun(1, stream, 64, 40);
+    simRun(1, NULL, 50, 40);
+    uartrx_stats(1, &st);
+    CHECK(st.overruns >= 1);
+    CHECK(rxq_read(1, out, sizeof(out)) < 64);
+}
+
+int main(void) {
+    uartrx_init(&simPort);
+    for (int chan=0; chan<Nchannels; chan++) {
+        uart[chan].pending = -1;
+    }
+    testBurstDrain();
+    testLineErrors();
+    testOverrun();
+    return CHECK_REPORT("uartrxTest");
+}
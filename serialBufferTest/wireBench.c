@@ -0,0 +1,135 @@
+// 2023 FIF orientering
+// Host benchmark of the compact radio format (wire.c) over a generated event: RUNNERS
+// runners with interval starts punch 1 to 4 stations heard by one buffer, in time order,
+// cards of 3 and 4 bytes, backup memory going up per station. By stations and keyframe
+// interval: bytes on the air against the punches as received, ns per punch to encode and
+// to decode, whether the decoder gives back the same bytes, and the punches lost per punch
+// (or record) lost on the air, 2 % of them. Prints CSV.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "wire.h"
+#include "punch.h"
+
+#define RUNNERS 2000
+#define STATIONS_MAX 4
+#define PUNCHES (RUNNERS * STATIONS_MAX)
+#define ROUNDS 20
+#define LOSS_PERCENT 2
+
+typedef struct {
+    uint32_t time;              // [1/256 s] of the day
+    uint8_t p[PUNCH_LEN];
+} event_punch_t;
+
+static event_punch_t event[PUNCHES];
+static uint8_t in[PUNCHES * PUNCH_LEN], air[PUNCHES * PUNCH_LEN], out[WIRE_DECODE_ROOM(PUNCHES * PUNCH_LEN)];
+static size_t recordLen[PUNCHES];
+static wire_decoder_t dec;
+
+static uint32_t seed = 1;
+static uint32_t rnd(uint32_t range) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int byTime(const void *a, const void *b) {
+    uint32_t ta = ((const event_punch_t *)a)->time, tb = ((const event_punch_t *)b)->time;
+    return ta < tb ? -1 : ta > tb;
+}
+
+// Starts every 5 s from 10:00, 2 to 10 minutes a leg; returns the punch count
+static size_t makeEvent(int stations) {
+    uint32_t mem[STATIONS_MAX];
+    size_t n = 0;
+    for (int r=0; r<RUNNERS; r++) {
+        uint32_t card = rnd(10) < 9 ? 2000000 + rnd(7000000) : 0x0F000000 | rnd(1 << 24);
+        uint32_t t = (36000 + r * 5) * 256, pace = 70 + rnd(80);                // [%]
+        for (int s=0; s<stations; s++) {
+            t += (120 + rnd(480)) * pace / 100 * 256 + rnd(256);
+            event[n].time = t;
+            uint32_t sec = t / 256;
+            punch_make(event[n].p, 31 + s, card, (sec / 43200) | 0x03 << 1, sec % 43200, t & 0xFF);
+            n++;
+        }
+    }
+    qsort(event, n, sizeof(event_punch_t), byTime);
+    for (int s=0; s<stations; s++) {
+        mem[s] = rnd(1000) * 8;
+    }
+    for (size_t i=0; i<n; i++) {
+        int s = event[i].p[4] - 31;
+        punch_mem(event[i].p, mem[s] += 8);
+        memcpy(in + i * PUNCH_LEN, event[i].p, PUNCH_LEN);
+    }
+    return n;
+}
+
+static size_t encode(size_t punches, uint32_t every) {
+    size_t len = 0;
+    wire_init(every);
+    for (size_t i=0; i<punches; i++) {
+        memcpy(air + len, event[i].p, PUNCH_LEN);
+        recordLen[i] = wire_encode(0, air + len, PUNCH_LEN);
+        len += recordLen[i];
+    }
+    return len;
+}
+
+// Punches that come out whole with LOSS_PERCENT of the records lost on the way
+static size_t survivors(size_t punches, size_t *dropped) {
+    size_t len = 0, at = 0;
+    *dropped = 0;
+    wire_decoder_init(&dec);
+    for (size_t i=0; i<punches; i++) {
+        if (rnd(100) < LOSS_PERCENT) {
+            (*dropped)++;
+        } else {
+            len += wire_decode(&dec, air + at, recordLen[i], out + len);
+        }
+        at += recordLen[i];
+    }
+    wire_decode_flush(&dec, out + len);
+    return dec.stats.punches + dec.stats.decoded;
+}
+
+static void bench(int stations, size_t punches, uint32_t every) {
+    size_t airLen = 0, outLen = 0, dropped;
+    uint64_t start = nowNs();
+    for (int round=0; round<ROUNDS; round++) {
+        airLen = encode(punches, every);
+    }
+    double encodeNs = (double)(nowNs() - start) / ROUNDS / punches;
+    start = nowNs();
+    for (int round=0; round<ROUNDS; round++) {
+        wire_decoder_init(&dec);
+        outLen = wire_decode(&dec, air, airLen, out);
+        outLen += wire_decode_flush(&dec, out + outLen);
+    }
+    double decodeNs = (double)(nowNs() - start) / ROUNDS / punches;
+    int same = outLen == punches * PUNCH_LEN && memcmp(out, in, outLen) == 0;
+    size_t whole = survivors(punches, &dropped);
+    printf("%d,%lu,%zu,%zu,%zu,%.3f,%.1f,%.1f,%d,%.2f\n", stations, (unsigned long)every, punches,
+           punches * PUNCH_LEN, airLen, (double)airLen / (punches * PUNCH_LEN), encodeNs, decodeNs, same,
+           dropped ? (double)(punches - whole) / dropped : 0.0);
+}
+
+int main(void) {
+    const uint32_t every[] = {1, 4, 8, 16, 32};
+    printf("stations,keyframe_every,punches,bytes_in,bytes_out,ratio,encode_ns_per_punch,decode_ns_per_punch,identical,lost_per_lost\n");
+    for (int stations=1; stations<=STATIONS_MAX; stations*=2) {
+        size_t punches = makeEvent(stations);
+        for (unsigned e=0; e<sizeof(every) / sizeof(every[0]); e++) {
+            bench(stations, punches, every[e]);
+        }
+    }
+    return 0;
+}
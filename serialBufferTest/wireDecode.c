@@ -0,0 +1,85 @@
+// 2023 FIF orientering
+// Decoder of the compact radio format (wire.h) for the computer at the radio end: reads the
+// radio modem's stream, writes the punches and other bytes as the stations sent them. What
+// waits to tell a punch or record goes out once the link has been quiet QUIET_MS.
+//   wireDecode [device [baud]] > out
+// Without a device it reads stdin. For event software that opens a serial port, give it one
+// end of a pseudo terminal pair, e.g.
+//   socat pty,raw,echo=0,link=/tmp/ttySI EXEC:"wireDecode /dev/ttyUSB0 38400"
+// Prints the decoder counts to stderr at the end of the input.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "wire.h"
+
+#define QUIET_MS 50
+
+static speed_t speed(long baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        default: return 0;
+    }
+}
+
+static int openPort(const char *device, long baud) {
+    struct termios tio;
+    int fd = open(device, O_RDONLY | O_NOCTTY);
+    if (fd < 0 || tcgetattr(fd, &tio) != 0) {
+        perror(device);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, speed(baud));
+    cfsetospeed(&tio, speed(baud));
+    tio.c_cflag |= CLOCAL | CREAD | CRTSCTS;
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        perror(device);
+        return -1;
+    }
+    return fd;
+}
+
+static void put(const uint8_t *data, size_t len) {
+    if (len > 0 && fwrite(data, 1, len, stdout) != len) {
+        perror("stdout");
+        exit(1);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    static wire_decoder_t dec;
+    uint8_t in[256], out[WIRE_DECODE_ROOM(sizeof(in))];
+    long baud = argc > 2 ? atol(argv[2]) : 38400;
+    int fd = 0;
+    if (argc > 1 && (speed(baud) == 0 || (fd = openPort(argv[1], baud)) < 0)) {
+        fprintf(stderr, "usage: wireDecode [device [9600|19200|38400|57600|115200]]\n");
+        return 1;
+    }
+    wire_decoder_init(&dec);
+    for (;;) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, dec.count > 0 ? QUIET_MS : -1) == 0) {
+            put(out, wire_decode_flush(&dec, out));     // Quiet: the link stopped mid way
+            continue;
+        }
+        ssize_t n = read(fd, in, sizeof(in));
+        if (n <= 0) {
+            break;
+        }
+        put(out, wire_decode(&dec, in, n, out));
+    }
+    put(out, wire_decode_flush(&dec, out));
+    fprintf(stderr, "wireDecode: %lu bytes in, %lu out, %lu punches in full, %lu decoded, %lu unmatched\n",
+            (unsigned long)dec.stats.bytesIn, (unsigned long)dec.stats.bytesOut, (unsigned long)dec.stats.punches,
+            (unsigned long)dec.stats.decoded, (unsigned long)dec.stats.unmatched);
+    return 0;
+}
@@ -0,0 +1,228 @@
+// 2023 FIF orientering
+// Host tests of the compact radio format (wire.c): punches of several stations with other
+// bytes between them come out of the decoder as they went in, keyframes bring the decoder
+// back after lost packets, punches of a station through two channels decode out of order,
+// and the framer sends records that decode to what it received.
+
+#include <string.h>
+#include "wire.h"
+#include "framer.h"
+#include "frameq.h"
+#include "check.h"
+#include "punch.h"
+
+#define PUNCHES 400
+#define EVERY 8
+#define BUF_SIZE (32 * 1024)
+
+static uint8_t in[BUF_SIZE], air[BUF_SIZE], out[WIRE_DECODE_ROOM(BUF_SIZE)];
+static wire_decoder_t dec;
+
+static uint32_t seed = 1;
+static uint32_t rnd(uint32_t range) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+// Punch i of an event at four stations: times and backup memory going up per station
+static void makePunch(uint8_t p[PUNCH_LEN], int i) {
+    static uint32_t seconds[4], mem[4];
+    int station = i % 4;
+    seconds[station] += 1 + rnd(20);
+    mem[station] += 8;
+    uint32_t s = 36000 + seconds[station];
+    punch_make(p, 31 + station, 500000 + rnd(100000), (s / 43200) | 0x02 << 1, s % 43200, rnd(256));
+    punch_mem(p, mem[station]);
+}
+
+static size_t decodeAll(const uint8_t *data, size_t len) {
+    size_t n = 0;
+    for (size_t at=0; at<len; at+=7) {                  // in pieces, as a serial port reads
+        n += wire_decode(&dec, data + at, len - at < 7 ? len - at : 7, out + n);
+    }
+    return n + wire_decode_flush(&dec, out + n);
+}
+
+// Encoded and decoded back, with other bytes between the punches: the same stream
+static void testRoundTrip(void) {
+    size_t inLen = 0, airLen = 0;
+    wire_stats_t st;
+    wire_init(EVERY);
+    wire_decoder_init(&dec);
+    for (int i=0; i<PUNCHES; i++) {
+        uint8_t p[PUNCH_LEN];
+        size_t len = PUNCH_LEN;
+        makePunch(p, i);
+        if (i % 5 == 3) {                               // A punch without STX and ETX
+            memmove(p, p + 1, PUNCH_LEN - 2);
+            len = PUNCH_LEN - 2;
+        }
+        memcpy(in + inLen, p, len);
+        inLen += len;
+        memcpy(air + airLen, p, len);
+        airLen += wire_encode(0, air + airLen, len);
+        if (i % 7 == 0) {                               // Other bytes, looking like records and punches
+            const uint8_t noise[] = {0xF1, 0x1F, 0x02, 0xD3, 0x0D, 0xF0, 0x55};
+            size_t k = 1 + rnd(sizeof(noise));
+            memcpy(in + inLen, noise, k);
+            memcpy(air + airLen, noise, k);
+            inLen += k;
+            airLen += k;
+        }
+    }
+    size_t outLen = decodeAll(air, airLen);
+    CHECK(outLen == inLen && memcmp(out, in, inLen) == 0);
+    wire_stats(&st);
+    CHECK(st.punches == PUNCHES && st.keyframes >= PUNCHES / EVERY && st.keyframes <= PUNCHES / EVERY + 8);
+    CHECK(st.bytesOut * 100 < st.bytesIn * 65);         // less than 65 %
+    CHECK(dec.stats.decoded == PUNCHES - st.keyframes && dec.stats.punches == st.keyframes);
+}
+
+// The punches a decoded stream has, by card number; false if one is not a sent punch
+static bool punchesIn(const uint8_t *data, size_t len, const uint8_t sent[][PUNCH_LEN], bool got[]) {
+    for (size_t at=0; at + PUNCH_LEN <= len; at+=PUNCH_LEN) {
+        int i;
+        for (i=0; i<PUNCHES && memcmp(data + at, sent[i], PUNCH_LEN) != 0; i++) {
+        }
+        if (i == PUNCHES) {
+            return false;
+        }
+        got[i] = true;
+    }
+    return true;
+}
+
+// Packets of five punches, every eleventh lost: the punches coded on a lost keyframe are lost
+// (their records go on as bytes), no others, and no punch comes out wrong
+static void testLoss(void) {
+    static uint8_t sent[PUNCHES][PUNCH_LEN];
+    bool got[PUNCHES] = {false};
+    size_t airLen = 0, lost = 0;
+    wire_init(EVERY);
+    wire_decoder_init(&dec);
+    for (int i=0; i<PUNCHES; i++) {
+        makePunch(sent[i], i);
+        uint8_t p[PUNCH_LEN];
+        memcpy(p, sent[i], PUNCH_LEN);
+        size_t n = wire_encode(0, p, PUNCH_LEN);
+        if (i / 5 % 11 == 10) {
+            lost++;
+        } else {
+            memcpy(air + airLen, p, n);
+            airLen += n;
+        }
+    }
+    size_t outLen = decodeAll(air, airLen);
+    // Keep the punches only: undecodable records pass as bytes
+    size_t punches = 0;
+    for (size_t at=0; at + PUNCH_LEN <= outLen; ) {
+        if (out[at] == 0x02 && out[at + 1] == 0xD3 && sicrc(out + at + 1, 15) == (out[at + 16] << 8 | out[at + 17])) {
+            memmove(out + punches * PUNCH_LEN, out + at, PUNCH_LEN);
+            punches++;
+            at += PUNCH_LEN;
+        } else {
+            at++;
+        }
+    }
+    CHECK(punchesIn(out, punches * PUNCH_LEN, sent, got));
+    int missing = 0;
+    for (int i=0; i<PUNCHES; i++) {
+        missing += !got[i];
+    }
+    CHECK(missing >= (int)lost && missing <= (int)lost + (int)(PUNCHES / 55 * 4 * EVERY));
+    CHECK(dec.stats.unmatched >= (uint32_t)(missing - lost));
+}
+
+// A station heard on two channels, each with its own keyframes; the channels' punches
+// arrive in blocks out of order: all decode
+static void testChannels(void) {
+    static uint8_t sent[PUNCHES][PUNCH_LEN];
+    static uint8_t records[2][PUNCHES][PUNCH_LEN];
+    static size_t recordLen[2][PUNCHES];
+    bool got[PUNCHES] = {false};
+    int count[2] = {0, 0}, next[2] = {0, 0};
+    wire_init(EVERY);
+    wire_decoder_init(&dec);
+    for (int i=0; i<PUNCHES; i++) {
+        makePunch(sent[i], i * 4);                      // all of station 31
+        int chan = rnd(2);
+        memcpy(records[chan][count[chan]], sent[i], PUNCH_LEN);
+        recordLen[chan][count[chan]] = wire_encode(chan, records[chan][count[chan]], PUNCH_LEN);
+        count[chan]++;
+    }
+    size_t outLen = 0;
+    for (int block=0; next[0] < count[0] || next[1] < count[1]; block++) {   // ten at a time
+        int chan = block % 2;
+        for (int k=0; k<10 && next[chan] < count[chan]; k++, next[chan]++) {
+            outLen += wire_decode(&dec, records[chan][next[chan]], recordLen[chan][next[chan]], out + outLen);
+        }
+    }
+    outLen += wire_decode_flush(&dec, out + outLen);
+    CHECK(outLen == PUNCHES * PUNCH_LEN && punchesIn(out, outLen, sent, got));
+    CHECK(dec.stats.decoded + dec.stats.punches == PUNCHES && dec.stats.unmatched == 0);
+}
+
+// A punch the record cannot give back goes in full
+static void testInFull(void) {
+    uint8_t p[PUNCH_LEN], q[PUNCH_LEN];
+    wire_init(EVERY);
+    punch_make(p, 31, 1, 0x02, 100, 0);
+    CHECK(wire_encode(0, p, PUNCH_LEN) == PUNCH_LEN);              // the keyframe
+    punch_make(q, 31, 2, 0x02, 101, 0);
+    memcpy(p, q, PUNCH_LEN);
+    CHECK(wire_encode(0, p, PUNCH_LEN) < PUNCH_LEN);               // a record
+    punch_make(q, 31, 3, 0x42, 102, 0);                            // TD bit 6
+    memcpy(p, q, PUNCH_LEN);
+    CHECK(wire_encode(0, p, PUNCH_LEN) == PUNCH_LEN && memcmp(p, q, PUNCH_LEN) == 0);
+    punch_make(q, 31, 4, 0x02, 43200 - 1 + 4200, 0);               // past the half day
+    memcpy(p, q, PUNCH_LEN);
+    CHECK(wire_encode(0, p, PUNCH_LEN) == PUNCH_LEN);
+    punch_make(q, 31, 5, 0x03, 100 + 4100, 0);                     // beyond the delta, a new keyframe
+    memcpy(p, q, PUNCH_LEN);
+    CHECK(wire_encode(0, p, PUNCH_LEN) == PUNCH_LEN);
+    wire_init(0);                                                  // off
+    punch_make(q, 31, 6, 0x03, 4201, 0);
+    memcpy(p, q, PUNCH_LEN);
+    CHECK(wire_encode(0, p, PUNCH_LEN) == PUNCH_LEN && memcmp(p, q, PUNCH_LEN) == 0);
+}
+
+// Through the framer: the frames sent decode to the bytes received
+static void testFramer(void) {
+    frame_t frame;
+    ring_span_t data[2];
+    size_t inLen = 0, airLen = 0;
+    frameq_stats_t before, after;
+    frameq_stats(0, &before);
+    wire_init(EVERY);
+    wire_decoder_init(&dec);
+    for (int i=0; i<PUNCHES; i++) {
+        size_t from = inLen;
+        if (i % 9 == 4) {
+            in[inLen++] = 0x55;                                    // Another byte before it
+        }
+        makePunch(in + inLen, i);
+        inLen += PUNCH_LEN;
+        CHECK(rxq_write(0, in + from, inLen - from) == inLen - from);
+        framer_run(0);
+        while (frameq_read(0, &frame, data)) {
+            memcpy(air + airLen, data[0].data, data[0].len);
+            memcpy(air + airLen + data[0].len, data[1].data, data[1].len);
+            airLen += frame.len;
+            frameq_release(&frame);
+        }
+    }
+    CHECK(decodeAll(air, airLen) == inLen && memcmp(out, in, inLen) == 0);
+    CHECK(airLen * 100 < inLen * 65);
+    frameq_stats(0, &after);
+    CHECK(after.dropped - before.dropped == inLen - airLen);
+    wire_init(0);
+}
+
+int main(void) {
+    testRoundTrip();
+    testLoss();
+    testChannels();
+    testInFull();
+    testFramer();
+    return CHECK_REPORT("wireTest");
+}